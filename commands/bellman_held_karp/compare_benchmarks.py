@@ -0,0 +1,66 @@
+import csv
+import sys
+
+
+CONFIG_COLUMNS = ['num_points', 'cost_t', 'symmetric', 'problem',
+                  'find_path', 'threads']
+# relative drop of relaxations per second reported as a regression
+DEFAULT_THRESHOLD = 0.05
+
+
+def main():
+    if len(sys.argv) < 3:
+        print('Usage: compare_benchmarks.py <baseline.csv> <new.csv>'
+              ' [threshold]')
+        sys.exit(1)
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 \
+                else DEFAULT_THRESHOLD
+    baseline = load_results(sys.argv[1])
+    new = load_results(sys.argv[2])
+
+    num_regressions = 0
+    num_mismatches = 0
+    print(f'{"configuration":<44}{"base/s":>12}{"new/s":>12}'
+          f'{"speedup":>9}{"base mem":>10}{"new mem":>10}')
+    for config, new_row in new.items():
+        base_row = baseline.get(config)
+        if base_row is None:
+            continue
+        base_rate = float(base_row['relaxations_per_s'])
+        new_rate = float(new_row['relaxations_per_s'])
+        speedup = new_rate / base_rate if base_rate > 0 else float('inf')
+        note = ''
+        if speedup < 1. - threshold:
+            note = '  REGRESSION'
+            num_regressions += 1
+        # same instance and scaling, optimal costs must not change
+        if float(base_row['cost']) != float(new_row['cost']):
+            note += '  COST MISMATCH'
+            num_mismatches += 1
+        print(f'{format_config(config):<44}{base_rate:>12.4g}'
+              f'{new_rate:>12.4g}{speedup:>9.3f}'
+              f'{base_row["rss_growth_kb"]:>10}{new_row["rss_growth_kb"]:>10}'
+              f'{note}')
+
+    print(f'\nRegressions (>{100 * threshold:.1f}% slower): {num_regressions}')
+    print(f'Cost mismatches: {num_mismatches}')
+    sys.exit(1 if num_regressions or num_mismatches else 0)
+
+
+def load_results(path):
+    with open(path, newline='') as file:
+        return {
+            tuple(row[col] for col in CONFIG_COLUMNS): row
+            for row in csv.DictReader(file)
+        }
+
+
+def format_config(config):
+    num_points, cost_t, symmetric, problem, find_path, threads = config
+    return (f'n={num_points} {cost_t} {"S" if symmetric == "1" else "A"}'
+            f'{problem.upper()} {"path" if find_path == "1" else "cost"}'
+            f' t={threads}')
+
+
+if __name__ == '__main__':
+    main()
@@ -57,6 +57,11 @@ MAX_N = 30
 MODES = ['tsp']
 IS_SYMMETRIC = True
 PARALLEL_CAPACITY = None
+# solve all of MIN_N..MAX_N in a single run over MAX_N points, its output
+# is split into a file per num of points
+ALL_PREFIXES = False
+# each run also writes its finished layers as JSON lines next to its output
+PROGRESS_LOG = False
 
 
 def main():
@@ -66,6 +71,12 @@ def main():
             print(f'\n\necho "solving {cost_dtype} {mode}"')
             vertex_type_size = 1  # in bytes, always int8_t
             precision = 1e12 if 'int32_t' not in cost_dtype else 1e4
+            if ALL_PREFIXES:
+                print_prefixes_sh_command(MIN_N, MAX_N, SINGLE_TEST_TIMEOUT_SEC,
+                                          precision, NUM_RERUNS, cost_dtype,
+                                          vertex_type_size, mode,
+                                          IS_PROBLEM_IN_PTS_FORMAT)
+                continue
             print_sh_commands(MIN_N, MAX_N, SINGLE_TEST_TIMEOUT_SEC,
                               precision, NUM_RERUNS, IS_SYMMETRIC,
                               cost_dtype, vertex_type_size, mode,
@@ -83,9 +94,13 @@ def print_sh_commands(min_n, max_n, timeout_secs, precision, num_reruns, is_symm
     for n in range(min_n, max_n + 1):
         # provide min memory to enforce given dtype
         mem = space(n, mode == 'tsp', is_symmetric, dtype_size(cost_t), tv)
+        # threads, layers dir, recompute path, delta bytes, bidirectional,
+        # checkpoint dir, all prefixes, progress log
+        progress = f' 1 "" 0 0 0 "" 0 "$RESULTS_DIR/{PROBLEM_NAME}/{mode}/{cost_t}/{n}.jsonl"' \
+                 if PROGRESS_LOG else ''
         cmd = f'"$SRC_DIR/main.exe" {n} "$PROBLEMS_DIR/{PROBLEM_FNAME}" {num_reruns} ' \
             + f'{precision:.0e} {mem} {do_not_prefer_int} {timeout_secs} {mode} ' \
-            + f'{is_dist_pts_fmt} > "$RESULTS_DIR/{PROBLEM_NAME}/{mode}/{cost_t}/{n}.txt"' \
+            + f'{is_dist_pts_fmt}{progress} > "$RESULTS_DIR/{PROBLEM_NAME}/{mode}/{cost_t}/{n}.txt"' \
             + (' &' if parallel_cap is not None else '')
         print(f'\n# RAM: {mem / 2**30:.3f} GB = {mem / 2**20:.3f} MB')
         print(f'echo "Solving {n} points..."')
@@ -95,6 +110,27 @@ def print_sh_commands(min_n, max_n, timeout_secs, precision, num_reruns, is_symm
     if parallel_cap is not None and (max_n - min_n + 1) % parallel_cap != 0:
         print('\nwait\n')
 
+def print_prefixes_sh_command(min_n, max_n, timeout_secs, precision, num_reruns,
+                              cost_t: str, tv=1, mode='shp', is_dist_pts_fmt=1):
+    results_dir = f'$RESULTS_DIR/{PROBLEM_NAME}/{mode}/{cost_t}'
+    print(f'mkdir -p "{results_dir}"')
+    do_not_prefer_int = 1 if 'int' not in cost_t else 0
+    # halves are not merged, so memory is that of an asymmetric run
+    mem = space(max_n, mode == 'tsp', False, dtype_size(cost_t), tv)
+    # threads, layers dir, recompute path, delta bytes, bidirectional,
+    # checkpoint dir, all prefixes
+    cmd = f'"$SRC_DIR/main.exe" {max_n} "$PROBLEMS_DIR/{PROBLEM_FNAME}" {num_reruns} ' \
+        + f'{precision:.0e} {mem} {do_not_prefer_int} {timeout_secs} {mode} ' \
+        + f'{is_dist_pts_fmt} 1 "" 0 0 0 "" 1' \
+        + f' | awk -v dir="{results_dir}" -v min_n={min_n}' \
+        + " '/total distance \\(scaled\\) for [0-9]+ points/" \
+        + " { out = $6 >= min_n ? dir \"/\" $6 \".txt\" : \"\" }" \
+        + " out != \"\" { print > out }'"
+    print(f'\n# RAM: {mem / 2**30:.3f} GB = {mem / 2**20:.3f} MB')
+    print(f'echo "Solving 1 to {max_n} points..."')
+    print(cmd)
+
+
 def space(n, cycle: bool, is_symmetric: bool, tc=2, tv=1):
     if cycle:
         n -= 1
@@ -0,0 +1,27 @@
+#!/bin/bash
+# Usage: run_benchmark.sh [min_num_points] [max_num_points] [num_reruns] [num_threads]
+# Results go to results/bellman_held_karp/benchmark/<commit>.csv, compare
+# two of them with compare_benchmarks.py.
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+SRC_DIR="$SCRIPT_DIR/../../src/bellman_held_karp"
+PROBLEMS_DIR="$SCRIPT_DIR/../../problems"
+RESULTS_DIR="$SCRIPT_DIR/../../results/bellman_held_karp/benchmark"
+
+MIN_NUM_POINTS="${1:-12}"
+MAX_NUM_POINTS="${2:-20}"
+NUM_RERUNS="${3:-3}"
+NUM_THREADS="${4:-1}"
+BUILD_NAME="$(git -C "$SCRIPT_DIR" rev-parse --short HEAD 2>/dev/null || echo local)"
+
+echo "Compiling..."
+if ! g++ --static -std=c++20 -O3 -Wall -Wextra -o "$SRC_DIR/benchmark.exe" "$SRC_DIR/benchmark.cpp"; then
+    echo "Compilation failed."
+    exit 1
+fi
+
+mkdir -p "$RESULTS_DIR"
+echo "Benchmarking $MIN_NUM_POINTS to $MAX_NUM_POINTS points..."
+"$SRC_DIR/benchmark.exe" "$MIN_NUM_POINTS" "$MAX_NUM_POINTS" "$PROBLEMS_DIR/263.txt" \
+    "$RESULTS_DIR/$BUILD_NAME.csv" "$NUM_RERUNS" "$NUM_THREADS"
+echo "Results: $RESULTS_DIR/$BUILD_NAME.csv"
@@ -0,0 +1,328 @@
+#ifndef BATCH_HELD_KARP_HPP
+#define BATCH_HELD_KARP_HPP
+
+#include <vector>
+#include <span>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include "../common/thread_pool.hpp"
+#include "min_plus_kernels.hpp"
+#include "subset_rank.hpp"
+
+/**
+ * @brief Bellman-Held-Karp for many instances of the same size, e.g.
+ *        thousands of small subproblems (n ~ 8 - 20).
+ *        Rank tables and per worker workspace are built once and reused
+ *        by every instance. Instances are interleaved num_lanes at a
+ *        time, so each DP entry holds the costs of num_lanes instances
+ *        and a single SIMD min-plus serves all of them, while blocks
+ *        of instances are spread over the pool's workers.
+ *        No pruning nor symmetric halves merging, every state is live
+ *        in some instance, only throughput of whole batches matters.
+ * @tparam num_lanes - instances per block, a cache line of T by default
+ */
+template<
+    typename T,
+    typename vertex_t=uint8_t,
+    typename set_t=uint32_t,
+    int num_lanes=detail::min_plus::row_align_v<T>
+>
+class BatchHeldKarp {
+ public:
+
+    using ull = unsigned long long;
+
+    /// @param num_points - num of rows of each instance's weights,
+    ///                     starting point is the last if end_in_starting_point
+    /// @param num_threads - if 0 then all hardware threads
+    BatchHeldKarp(
+        const int num_points,
+        const bool end_in_starting_point,
+        const bool find_path=true,
+        const int num_threads=1
+    );
+
+    /**
+     * @brief Solves every instance, same as calling bellmanHeldKarp on
+     *        each, solutions may differ in ties among optimal paths.
+     * @param costs - resized to num of instances, min cost of each
+     * @param solutions - resized to num of instances iff find_path,
+     *                    paths in the format of bellmanHeldKarp
+     */
+    void solve(
+        std::vector<T> &costs,
+        std::vector<std::vector<vertex_t>> &solutions,
+        std::span<const std::vector<std::vector<T>>> instances
+    );
+
+    [[ nodiscard ]] int getNumPoints() const noexcept {
+        return this->num_points;
+    }
+
+ private:
+
+    struct Workspace {
+        std::vector<T> weights;  // [dst][src][lane], n + 1 rows
+        std::vector<T> costs_prev;  // [rank * card + end idx][lane]
+        std::vector<T> costs_next;
+        std::vector<vertex_t> prevs;  // [layer start + rank * card + end idx][lane]
+    };
+
+    const int num_points;
+    const int n;  // num of vertices the DP is run over
+    const bool end_in_starting_point;
+    const bool find_path;
+    threading::ThreadPool pool;
+    const detail::SubsetRanker<set_t> ranker;
+    // layer_starts[cardinality] = start of its previous vertices
+    std::vector<ull> layer_starts;
+    std::vector<Workspace> workspaces;
+
+    /// @brief Interleaves the block's instances, missing lanes repeat
+    ///        the last instance.
+    void loadBlock(
+        Workspace &ws,
+        std::span<const std::vector<std::vector<T>>> block
+    ) const;
+
+    template<bool find_path>
+    [[ gnu::hot ]]
+    void solveBlock(Workspace &ws, T * __restrict const costs,
+                    std::vector<vertex_t> * const solutions,
+                    const int num_instances) const;
+
+};
+
+
+template<typename T, typename vertex_t, typename set_t, int num_lanes>
+BatchHeldKarp<T, vertex_t, set_t, num_lanes>::BatchHeldKarp(
+    const int num_points,
+    const bool end_in_starting_point,
+    const bool find_path,
+    const int num_threads
+) : num_points(num_points),
+    n(end_in_starting_point ? num_points - 1 : num_points),
+    end_in_starting_point(end_in_starting_point),
+    find_path(find_path),
+    pool(num_threads),
+    ranker(std::max(this->n, 1), std::max(this->n - 1, 1))
+{
+    if (this->n < 2) {
+        throw std::invalid_argument(
+            "Batches need at least 2 vertices besides starting point, got "
+          + std::to_string(this->n)
+        );
+    }
+    if (static_cast<int> (sizeof(set_t) * 8) < this->n
+     || static_cast<int> (std::numeric_limits<vertex_t>::max()) < this->n
+    ) {
+        throw std::runtime_error(
+            "Cannot handle num of vertices V=" + std::to_string(this->n)
+          + " with set_t's num of bits or vertex_t's max value."
+        );
+    }
+
+    const detail::Binomials &bin_coef = this->ranker.binomials();
+    ull max_layer = 0ULL;
+    this->layer_starts.assign(this->n + 2, 0ULL);
+    for (int card = 1; card <= this->n; ++card) {
+        const ull layer = bin_coef(this->n, card) * card;
+        max_layer = std::max(max_layer, layer);
+        this->layer_starts[card + 1] = this->layer_starts[card] + layer;
+    }
+
+    this->workspaces.resize(this->pool.size());
+    for (Workspace &ws : this->workspaces) {
+        ws.weights.resize((this->n + 1) * (this->n + 1) * num_lanes);
+        ws.costs_prev.resize(max_layer * num_lanes);
+        ws.costs_next.resize(max_layer * num_lanes);
+        if (find_path) {
+            ws.prevs.resize(this->layer_starts.back() * num_lanes);
+        }
+    }
+}
+
+template<typename T, typename vertex_t, typename set_t, int num_lanes>
+void BatchHeldKarp<T, vertex_t, set_t, num_lanes>::solve(
+    std::vector<T> &costs,
+    std::vector<std::vector<vertex_t>> &solutions,
+    std::span<const std::vector<std::vector<T>>> instances
+) {
+    const ull num_instances = instances.size();
+    for (const auto &weights : instances) {
+        if (static_cast<int> (weights.size()) != this->num_points) {
+            throw std::invalid_argument(
+                "All instances of a batch must have "
+              + std::to_string(this->num_points) + " points."
+            );
+        }
+    }
+    costs.resize(num_instances);
+    if (this->find_path) solutions.resize(num_instances);
+
+    const ull num_blocks = (num_instances + num_lanes - 1) / num_lanes;
+    this->pool.parallelFor(num_blocks, [&] (const ull block_idx,
+                                            const int worker_idx) {
+        const ull first = block_idx * num_lanes;
+        const int num_in_block = static_cast<int> (
+            std::min<ull>(num_lanes, num_instances - first)
+        );
+        Workspace &ws = this->workspaces[worker_idx];
+        this->loadBlock(ws, instances.subspan(first, num_in_block));
+        if (this->find_path) {
+            this->template solveBlock<true>(ws, costs.data() + first,
+                                            solutions.data() + first,
+                                            num_in_block);
+        } else {
+            this->template solveBlock<false>(ws, costs.data() + first,
+                                             nullptr, num_in_block);
+        }
+    });
+}
+
+template<typename T, typename vertex_t, typename set_t, int num_lanes>
+void BatchHeldKarp<T, vertex_t, set_t, num_lanes>::loadBlock(
+    Workspace &ws,
+    std::span<const std::vector<std::vector<T>>> block
+) const {
+    const int num_rows = this->n + 1;
+    const int num_in_block = block.size();
+    for (int lane = 0; lane < num_lanes; ++lane) {
+        const auto &weights = block[std::min(lane, num_in_block - 1)];
+        for (int dst = 0; dst < num_rows; ++dst) {
+            for (int src = 0; src < num_rows; ++src) {
+                // a path has no starting point, nothing enters nor leaves it
+                const bool has_edge = this->end_in_starting_point
+                                   || (src < this->n && dst < this->n);
+                ws.weights[(dst * num_rows + src) * num_lanes + lane]
+                    = has_edge ? weights[src][dst] : (T) 0;
+            }
+        }
+    }
+}
+
+template<typename T, typename vertex_t, typename set_t, int num_lanes>
+template<bool find_path>
+void BatchHeldKarp<T, vertex_t, set_t, num_lanes>::solveBlock(
+    Workspace &ws,
+    T * __restrict const costs,
+    std::vector<vertex_t> * const solutions,
+    const int num_instances
+) const {
+    using lane_idx_t = detail::min_plus::lane_idx_t<T>;
+    const int n = this->n;
+    const int num_rows = n + 1;
+    const T * __restrict const weights = ws.weights.data();
+    const auto get_weights = [&] (const int src, const int dst)
+    [[ always_inline, gnu::hot ]] {
+        return weights + (dst * num_rows + src) * num_lanes;
+    };
+
+    // paths start in the starting point, row n, with no cost otherwise
+    T *costs_prev = ws.costs_prev.data();
+    T *costs_next = ws.costs_next.data();
+    for (int dst = 0; dst < n; ++dst) {
+        std::copy_n(get_weights(n, dst), num_lanes,
+                    costs_prev + dst * num_lanes);
+    }
+
+    detail::ExtensionRanks ranks;
+    for (int card = 1; card < n; ++card) {
+        const ull num_sets = this->ranker.binomials()(n, card);
+        vertex_t * const layer_prevs = ws.prevs.data()
+            + this->layer_starts[card + 1] * num_lanes;
+        const T * cost_prev = costs_prev;
+        ull set_idx = num_sets;
+        for (set_t set = this->ranker.first(ranks, 0ULL, card);
+             set_idx;
+             set = this->ranker.next(ranks, set),
+             --set_idx, cost_prev += card * num_lanes
+        ) {
+            int next_dst_rank = 0;
+            for (int dst = 0; dst < n; ++dst) {
+                if ((set >> dst) & 1) {
+                    ++next_dst_rank;
+                    continue;
+                }
+                alignas(64) T best[num_lanes];
+                alignas(64) lane_idx_t best_src[num_lanes];
+                {
+                    const lane_idx_t src = ranks.srcs[0];
+                    const T * __restrict const w = get_weights(src, dst);
+                    for (int lane = 0; lane < num_lanes; ++lane) {
+                        best[lane] = cost_prev[lane] + w[lane];
+                        best_src[lane] = src;
+                    }
+                }
+                for (int i = 1; i < card; ++i) {
+                    const lane_idx_t src = ranks.srcs[i];
+                    const T * __restrict const w = get_weights(src, dst);
+                    const T * __restrict const c = cost_prev + i * num_lanes;
+                    // branchless, so it vectorizes over lanes
+                    for (int lane = 0; lane < num_lanes; ++lane) {
+                        const T sum = c[lane] + w[lane];
+                        const bool is_lt = sum < best[lane];
+                        best[lane] = is_lt ? sum : best[lane];
+                        if constexpr (find_path) {
+                            best_src[lane] = is_lt ? src : best_src[lane];
+                        }
+                    }
+                }
+                const ull entry = this->ranker.rankWith(ranks, dst,
+                                                        next_dst_rank)
+                                * (card + 1) + next_dst_rank;
+                std::copy_n(best, num_lanes, costs_next + entry * num_lanes);
+                if constexpr (find_path) {
+                    vertex_t * const prev = layer_prevs + entry * num_lanes;
+                    for (int lane = 0; lane < num_lanes; ++lane) {
+                        prev[lane] = (vertex_t) best_src[lane];
+                    }
+                }
+            }
+        }
+        std::swap(costs_prev, costs_next);
+    }
+
+    // all vertices visited, costs_prev[end] for the only set of n vertices
+    for (int lane = 0; lane < num_instances; ++lane) {
+        T best_cost = std::numeric_limits<T>::max();
+        int best_end = 0;
+        for (int end = 0; end < n; ++end) {
+            const T cost = costs_prev[end * num_lanes + lane]
+                         + get_weights(end, n)[lane];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_end = end;
+            }
+        }
+        costs[lane] = best_cost;
+        if constexpr (!find_path) continue;
+
+        std::vector<vertex_t> &solution = solutions[lane];
+        solution.resize(this->end_in_starting_point ? n + 2 : n);
+        vertex_t * const path = solution.data() + this->end_in_starting_point;
+        set_t set = n == static_cast<int> (sizeof(set_t) * 8)
+                  ? ~static_cast<set_t>(0)
+                  : (static_cast<set_t>(1) << n) - 1;
+        int end = best_end;
+        for (int card = n; card >= 2; --card) {
+            path[card - 1] = (vertex_t) end;
+            const ull rank = card == n ? 0ULL : this->ranker.rank(set);
+            const int end_idx = __builtin_popcountll(
+                static_cast<ull>(set) & ((1ULL << end) - 1ULL)
+            );
+            const ull entry = this->layer_starts[card] + rank * card + end_idx;
+            set ^= static_cast<set_t>(1) << end;
+            end = ws.prevs[entry * num_lanes + lane];
+        }
+        path[0] = (vertex_t) end;
+        if (this->end_in_starting_point) {
+            solution.front() = solution.back() = (vertex_t) n;
+        }
+    }
+}
+
+#endif
@@ -2,29 +2,20 @@
 #define ALGORITHM_HPP
 
 #include <vector>
+#include <algorithm>
 #include <functional>
 #include <span>
+#include "../common/thread_pool.hpp"
+#include "min_plus_kernels.hpp"
+#include "layer_storage.hpp"
+#include "checkpoint.hpp"
+#include "layer_observer.hpp"
+#include "subset_rank.hpp"
+#include "fixed_held_karp.hpp"
+#include "sparse_held_karp.hpp"
 
 namespace detail {
 
-std::vector<std::vector<unsigned long long>> binomialsMatr(
-    const int max_n,
-    int max_k
-) {
-    using ull = unsigned long long;
-    if (max_k < 0) max_k = max_n;
-    std::vector<std::vector<ull>> coefs(
-        max_n + 1, std::vector<ull>(max_k + 1, 0)
-    );
-    for (int n = 0; n <= max_n; ++n) {
-        coefs[n][0] = 1ULL;
-        for (int k = 1; k <= std::min(n, max_k); ++k) {
-            coefs[n][k] = coefs[n-1][k-1] + coefs[n-1][k];
-        }
-    }
-    return coefs;
-}
-
 unsigned long long comb(const int n, int k) {
     if (k > n) return 0ULL;
     if (k * 2 > n) k = n - k;
@@ -41,17 +32,64 @@ unsigned long long comb(const int n, int k) {
 std::vector<unsigned long long> prevVertexStarts(
     const int n,
     const int max_k,
-    const std::vector<std::vector<unsigned long long>> &binomials
+    const Binomials &binomials
 ) {
     std::vector<unsigned long long> prev_starts(max_k, 0ULL);
     for (int k = 3; k < max_k; ++k) {
         prev_starts[k] = prev_starts[k - 1]
-                       + binomials[n][k - 1] * (n - (k - 1));
+                       + binomials(n, k - 1) * (n - (k - 1));
     }
     return prev_starts;
 }
 
-/// @param solution - changes to the found path iff find_path=true
+/// @brief Cost layers and stored previous vertices of a run, the backward
+///        run of a bidirectional one leaves them for the forward run.
+template<typename T, typename vertex_t, typename delta_t>
+struct DPTables {
+    CostLayer<T, delta_t> costs_big;
+    CostLayer<T, delta_t> costs_small;
+    LayerBuffer<vertex_t> previous_vertices;
+};
+
+/// @brief Optimal states of the first sets of all layers, the set of the
+///        first cardinality vertices is rank 0 of its layer in colex order
+///        and its states depend on no later vertex.
+template<typename T, typename vertex_t>
+struct PrefixStates {
+    std::vector<T> costs;  // [cardinality], closed into start if TSP
+    // [cardinality], from the first visited vertex, iff find_path
+    std::vector<std::vector<vertex_t>> paths;
+};
+
+/// @param solution - changes to the found path iff find_path=true,
+///                   empty if there is no path cheaper than best_cost
+/// @param best_cost - upper bound, states that cannot be completed below
+///                    it are pruned
+/// @param num_threads - each layer is split into rank ranges processed
+///                      in parallel, if 0 then all hardware threads
+/// @param layers_dir - if not empty layers are kept out-of-core in
+///                     memory-mapped files in this directory
+/// @param recompute_path - no previous vertices are stored, each half
+///                         of the path is found by solving the smaller
+///                         instance spanning it, at cost-only memory
+/// @param checkpoint_dir - if not empty each finished layer is saved
+///                         there, a run of the same instance continues
+///                         from the last saved one
+/// @param backward_run - if not nullptr, this is the backward run of a
+///                       bidirectional one, layers up to the merge are
+///                       left in it and nothing is merged
+/// @param prefixes - if not nullptr, costs, and paths if find_path, of
+///                   the first sets of all layers below n are stored in
+///                   it, only for unmerged runs without a bound
+/// @tparam delta_t - if narrower than T, each set's costs are stored as a
+///                   base of type T and deltas of this type from it, span
+///                   of each weights column has to be below its max;
+///                   if a half float (T is float), costs are stored
+///                   rounded to it
+/// @tparam is_bidirectional - asymmetric instance is solved up to n / 2
+///                            both forward from the start and backward
+///                            over transposed weights, halves are merged
+///                            as symmetric ones are
 /// @return min cost
 template<
     typename T,
@@ -60,14 +98,22 @@ template<
     bool has_no_neg_weights=true,
     bool find_path=true,
     typename vertex_t=uint8_t,
-    typename set_t=uint64_t
+    typename set_t=uint64_t,
+    typename delta_t=T,
+    bool is_bidirectional=false
 >
 [[ gnu::hot ]]
 T bellmanHeldKarp(
     std::vector<vertex_t> &solution,
     const std::vector<std::vector<T>> &weights,
     const bool end_in_starting_point,
-    T best_cost = std::numeric_limits<T>::max()
+    T best_cost = std::numeric_limits<T>::max(),
+    const int num_threads = 1,
+    const std::string &layers_dir = "",
+    const bool recompute_path = false,
+    const std::string &checkpoint_dir = "",
+    DPTables<T, vertex_t, delta_t> * const backward_run = nullptr,
+    PrefixStates<T, vertex_t> * const prefixes = nullptr
 ) {
     using ull = unsigned long long;
     if (weights.size() == 0) {
@@ -120,12 +166,38 @@ T bellmanHeldKarp(
         return add_to_set(~set, vertex) & all_vertices;
     };
 
+    // weights are flat rows padded to cache lines, flat_weights[src][dst]
+    // for SIMD kernels relaxing all dsts of a src at once and the same
+    // transposed, weights_into[dst][src], for loops over srcs of a fixed
+    // dst, both are the same rows for symmetric instances
+    constexpr int row_align = min_plus::row_align_v<T>;
+    const int flat_stride = (n + row_align - 1) / row_align * row_align;
+    std::vector<T> flat_weights(n * flat_stride, inf);
+    std::vector<T> transposed_weights;
+    for (int src = 0; src < n; ++src) {
+        for (int dst = 0; dst < n; ++dst) {
+            flat_weights[src * flat_stride + dst] = is_symmetric
+                                                  ? weights[dst][src]
+                                                  : weights[src][dst];
+        }
+    }
+    if constexpr (!is_symmetric) {
+        transposed_weights.assign(n * flat_stride, inf);
+        for (int src = 0; src < n; ++src) {
+            for (int dst = 0; dst < n; ++dst) {
+                transposed_weights[dst * flat_stride + src]
+                    = weights[src][dst];
+            }
+        }
+    }
+    const T * const weights_into = is_symmetric ? flat_weights.data()
+                                                : transposed_weights.data();
+
     // utilize cache since src is changing within fixed dst in nested loop
-    const auto get_weight = [&weights] (
+    const auto get_weight = [weights_into, flat_stride] (
         const vertex_t s, const vertex_t d
     ) [[ always_inline, gnu::hot ]] {
-        if constexpr (is_symmetric) return weights[d][s];
-        return weights[s][d];
+        return weights_into[d * flat_stride + s];
     };
 
     constexpr auto store_sum_iflt = [] (const T x, const T y, T &c) {
@@ -146,19 +218,101 @@ T bellmanHeldKarp(
         return false;
     };
 
-    const auto find_best_ending = [&store_sum_iflt, &get_weight] (
+    // nullptr if there is no kernel for T on this CPU
+    const auto relax_dsts = min_plus::selectRelaxDsts<T>();
+    const auto relax_srcs = min_plus::selectRelaxSrcs<T>();
+
+    // states which cannot be completed below best_cost are pruned, as
+    // completing a set still enters every vertex outside of it (and the
+    // start of a cycle) by at least its cheapest incoming edge, for
+    // symmetric cycles it also leaves it, so half of its two cheapest
+    // edges are paid; entries are doubled to stay integral
+    using bound_t = std::conditional_t<std::is_floating_point_v<T>,
+                                       double, ull>;
+    const bool do_prune = has_no_neg_weights && best_cost < inf;
+    std::vector<bound_t> min_entry(n, (bound_t) 0);
+    bound_t min_entry_all = (bound_t) 0;  // to enter all vertices
+    if (do_prune) {
+        const int num_ends = end_in_starting_point ? n + 1 : n;
+        const bool is_cycle_sym = is_symmetric && end_in_starting_point;
+        const auto cheapest_two = [&] (const int dst) {
+            T cheapest = inf;
+            T second = inf;
+            for (int src = 0; src < num_ends; ++src) {
+                if (src == dst) continue;
+                const T w = weights[src][dst];
+                if (w < cheapest) {
+                    second = cheapest;
+                    cheapest = w;
+                } else if (w < second) {
+                    second = w;
+                }
+            }
+            return std::make_pair(static_cast<bound_t>(cheapest),
+                                  static_cast<bound_t>(second));
+        };
+        for (int dst = 0; dst < n; ++dst) {
+            const auto [cheapest, second] = cheapest_two(dst);
+            min_entry[dst] = is_cycle_sym ? cheapest + second : 2 * cheapest;
+            min_entry_all += min_entry[dst];
+        }
+        if (end_in_starting_point) {
+            const bound_t cheapest = cheapest_two(n).first;
+            min_entry_all += is_cycle_sym ? cheapest : 2 * cheapest;
+        }
+    }
+    // state of the set is live iff its cost < threshold, i.e. it can
+    // still be completed below bound
+    const auto calc_live_threshold = [&min_entry, min_entry_all] (
+        const set_t set,
+        const T bound
+    ) [[ always_inline ]] -> bound_t {
+        bound_t remaining = min_entry_all;
+        for (set_t bits = set; bits; bits &= bits - 1) {
+            remaining -= min_entry[__builtin_ctzll(bits)];
+        }
+        if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<double>(bound) - remaining / 2.;
+        } else {
+            remaining = (remaining + 1ULL) / 2ULL;  // costs are integral
+            const ull ull_bound = static_cast<ull>(bound);
+            return remaining >= ull_bound ? 0ULL : ull_bound - remaining;
+        }
+    };
+    // iff is_reversed, edges go from dst into the set's ends
+    const auto find_best_ending = [&] (
         const set_t set,
         const T * prev_cost_iter,
         const vertex_t dst,
-        T &cost
+        T &cost,
+        const bool is_reversed = false
     ) [[ always_inline, gnu::hot ]] {
         vertex_t best_prev = (vertex_t) 0;
+        if (relax_srcs != nullptr) {
+            // gathered from dst's row, reversed edges leave dst
+            vertex_t srcs[64];
+            int32_t offsets[64];
+            int num_srcs = 0;
+            for (set_t src_bits = set; src_bits; src_bits &= src_bits - 1) {
+                srcs[num_srcs] = (vertex_t) __builtin_ctzll(src_bits);
+                offsets[num_srcs] = srcs[num_srcs];
+                ++num_srcs;
+            }
+            const T *row = (is_reversed ? flat_weights.data() : weights_into)
+                         + dst * flat_stride;
+            const int best_idx = relax_srcs(prev_cost_iter, offsets,
+                                            num_srcs, row, cost);
+            if (best_idx >= 0) best_prev = srcs[best_idx];
+            return best_prev;
+        }
         for (set_t src_bits = set;
              src_bits;
              src_bits &= src_bits - 1, ++prev_cost_iter
         ) {
             const vertex_t src = (vertex_t) __builtin_ctzll(src_bits);
-            const T weight = get_weight(src, dst);
+            const T weight = is_reversed
+                           ? flat_weights[dst * flat_stride + src]
+                           : get_weight(src, dst);
             if (store_sum_iflt(*prev_cost_iter, weight, cost))
                [[ unlikely ]] {
                 best_prev = src;
@@ -167,123 +321,533 @@ T bellmanHeldKarp(
         return best_prev;
     };
 
-    const int max_card = is_symmetric ? std::max(1, n / 2) : n - 1;
+    // halves of both symmetric and bidirectional runs meet at n / 2
+    constexpr bool is_merged = is_symmetric || is_bidirectional;
+    if (prefixes != nullptr
+     && (is_merged || do_prune || recompute_path || !checkpoint_dir.empty())
+    ) {
+        throw std::invalid_argument(
+            "Prefixes are only stored by unmerged runs of all states."
+        );
+    }
+    const int max_card = is_merged ? std::max(1, n / 2) : n - 1;
     const int big_cost_card = n / 2;
-    const int small_cost_card = n <= 2 ? 0 : n / 2 + (is_symmetric ? -1 : 1);
-    const std::vector<std::vector<ull>> bin_coef
-        = detail::binomialsMatr(n, max_card);
-    std::vector<T> costs_big(bin_coef[n][big_cost_card] * big_cost_card);
-    std::vector<T> costs_small(bin_coef[n][small_cost_card] * small_cost_card);
+    const int small_cost_card = n <= 2 ? 0 : n / 2 + (is_merged ? -1 : 1);
+    threading::ThreadPool pool(num_threads);
+    const SubsetRanker<set_t> ranker(n, max_card);
+    const Binomials &bin_coef = ranker.binomials();
+    using layer_t = CostLayer<T, delta_t>;
+    constexpr bool is_compressed = layer_t::is_compressed;
+    if constexpr (layer_t::has_bases) {
+        // a state further above another end of its set than any column's
+        // span is dominated by it, so only such states are ever dead
+        for (int dst = 0; dst <= n; ++dst) {
+            if (dst == n && !end_in_starting_point) break;
+            T lowest = inf;
+            T highest = (T) 0;
+            for (int src = 0; src < n; ++src) {
+                if (src == dst) continue;
+                lowest = std::min(lowest, weights[src][dst]);
+                highest = std::max(highest, weights[src][dst]);
+            }
+            if (n > 1 && highest - lowest >= static_cast<T>(layer_t::dead)) {
+                throw std::invalid_argument(
+                    "Span of weights into vertex " + std::to_string(dst)
+                  + " does not fit below max value of deltas' type."
+                );
+            }
+        }
+    }
+    // backward run is first, so only its layers read by the merge are kept
+    // while the forward layers are computed
+    DPTables<T, vertex_t, delta_t> backward;
+    if constexpr (is_bidirectional) {
+        if (backward_run == nullptr) {
+            std::vector<std::vector<T>> transposed(
+                weights.size(), std::vector<T>(weights.size())
+            );
+            for (size_t src = 0; src < weights.size(); ++src) {
+                for (size_t dst = 0; dst < weights.size(); ++dst) {
+                    transposed[dst][src] = weights[src][dst];
+                }
+            }
+            std::vector<vertex_t> no_solution;
+            bellmanHeldKarp<T, false, is_n_odd, has_no_neg_weights, find_path,
+                            vertex_t, set_t, delta_t, true>(
+                no_solution, transposed, end_in_starting_point, best_cost,
+                num_threads, layers_dir, recompute_path, checkpoint_dir,
+                &backward
+            );
+            // layer one short of the merge is needed only to read the path
+            if (!find_path || recompute_path) backward.costs_small.release();
+        }
+    }
+    DPTables<T, vertex_t, delta_t> own_tables;
+    DPTables<T, vertex_t, delta_t> &tables = backward_run != nullptr
+                                           ? *backward_run : own_tables;
+    layer_t &costs_big = tables.costs_big;
+    layer_t &costs_small = tables.costs_small;
+    costs_big.allocate(bin_coef(n, big_cost_card), big_cost_card, layers_dir);
+    costs_small.allocate(bin_coef(n, small_cost_card), small_cost_card,
+                         layers_dir);
     // prev_starts[cardinality_without_ending] = costs_prev segment start
     std::vector<ull> prev_starts;
-    std::vector<vertex_t> best_previous_vertices;
+    LayerBuffer<vertex_t> &best_previous_vertices = tables.previous_vertices;
     if constexpr (find_path) {
         prev_starts = detail::prevVertexStarts(n, max_card, bin_coef);
-        best_previous_vertices.resize(prev_starts.back());
+        if (!recompute_path) {
+            best_previous_vertices.allocate(prev_starts.back(), layers_dir);
+        }
     }
+    const bool is_out_of_core = costs_big.isFileBacked();
+    costs_big.firstTouch(pool);
+    costs_small.firstTouch(pool);
+    best_previous_vertices.firstTouch(pool);
 
-    const auto get_cost_start = [&bin_coef] (const set_t set)
-    [[ always_inline, gnu::hot ]] {
-        ull prev_rank = 0ULL;
-        int v_idx = 0;
-        for (set_t src_bits = set; src_bits; src_bits &= src_bits - 1) {
-            prev_rank += bin_coef[__builtin_ctzll(src_bits)][++v_idx];
+    bool is_next_big = big_cost_card & 1;
+    layer_t &first_row_costs = is_next_big ? costs_big : costs_small;
+    for (int dst = 0; dst < n; ++dst) {
+        const T cost = end_in_starting_point ? weights[n][dst] : (T) 0;
+        first_row_costs.storeBlock(dst, 1, &cost);
+    }
+
+    // first set of a layer is the prefix of its cardinality, closed into
+    // start by the cheapest of its ends
+    std::vector<vertex_t> prefix_ends;
+    if (prefixes != nullptr) {
+        prefixes->costs.assign(n, inf);
+        if constexpr (find_path) prefixes->paths.assign(n, {});
+        prefix_ends.assign(n, (vertex_t) 0);
+    }
+    const auto store_prefix = [&] (const layer_t &layer,
+                                   const int cardinality) {
+        if (prefixes == nullptr) return;
+        T block_costs[64];
+        const T * const costs = layer.block(0ULL, cardinality, block_costs);
+        for (int end = 0; end < cardinality; ++end) {
+            const T closing = end_in_starting_point ? weights[end][n] : (T) 0;
+            if (store_sum_iflt(costs[end], closing,
+                               prefixes->costs[cardinality])) {
+                prefix_ends[cardinality] = (vertex_t) end;
+            }
         }
-        return prev_rank * v_idx;  // rank * cardinality
     };
+    store_prefix(first_row_costs, 1);
 
-    bool is_next_big = big_cost_card & 1;
-    auto &first_row_costs = is_next_big ? costs_big : costs_small;
-    for (int dst = 0; dst < n; ++dst) {
-        first_row_costs[dst] = end_in_starting_point
-                             ? weights[n][dst] : (T) 0;
+    // layers are saved only for the same instance, layout and bound
+    const auto make_checkpoint_key = [&] () {
+        uint64_t hash = 14695981039346656037ULL;  // FNV-1a of weights
+        for (const auto &row : weights) {
+            const auto * const bytes = reinterpret_cast<const uint8_t *>(
+                row.data()
+            );
+            for (size_t i = 0; i < row.size() * sizeof(T); ++i) {
+                hash = (hash ^ bytes[i]) * 1099511628211ULL;
+            }
+        }
+        return "n=" + std::to_string(n)
+             + " cycle=" + std::to_string(end_in_starting_point)
+             + " symmetric=" + std::to_string(is_symmetric)
+             + " bidirectional=" + std::to_string(is_bidirectional)
+             + " prevs=" + std::to_string(find_path && !recompute_path)
+             + " cost=" + std::to_string(sizeof(T))
+             + (std::is_floating_point_v<T> ? "f" : "i")
+             + " delta=" + std::to_string(sizeof(delta_t))
+             + storageName<delta_t>()
+             + " vertex=" + std::to_string(sizeof(vertex_t))
+             + " weights=" + std::to_string(hash);
+    };
+    // declared after tables, so it is destroyed, waiting for the save in
+    // flight, before them
+    Checkpoint checkpoint(
+        checkpoint_dir, backward_run != nullptr ? "bhk_backward" : "bhk",
+        checkpoint_dir.empty() ? "" : make_checkpoint_key()
+    );
+    const double checkpoint_bound = do_prune
+                                  ? static_cast<double>(best_cost)
+                                  : std::numeric_limits<double>::infinity();
+    const auto stores_prevs = [&] (const int cardinality) {
+        return find_path && !recompute_path
+            && cardinality > 1 && cardinality < max_card - 1;
+    };
+    // path reconstruction starts from the layer before the last one
+    const bool keeps_halves_layer = find_path && !recompute_path;
+
+    // continue from the last layer a previous run of this one has saved
+    int first_cardinality = 1;
+    const int resumed_card = checkpoint.findResumable(checkpoint_bound);
+    if (resumed_card > 1 && resumed_card <= max_card) {
+        const auto load_costs = [&] (const int cardinality) {
+            const bool is_big = ((big_cost_card - cardinality) & 1) == 0;
+            layer_t &layer = is_big ? costs_big : costs_small;
+            checkpoint.loadCosts(cardinality, [&] (const int fd) {
+                layer.forEachRawBlock(
+                    bin_coef(n, cardinality), cardinality,
+                    [fd] (char * const bytes, const size_t num_bytes) {
+                        Checkpoint::readAll(fd, bytes, num_bytes);
+                    }
+                );
+            });
+        };
+        load_costs(resumed_card);
+        if (resumed_card == max_card && keeps_halves_layer
+         && resumed_card > 2
+        ) {
+            load_costs(resumed_card - 1);
+        }
+        for (int cardinality = 2; cardinality < resumed_card; ++cardinality) {
+            if (!stores_prevs(cardinality)) continue;
+            checkpoint.loadPrevs(cardinality, [&] (const int fd) {
+                Checkpoint::readAll(
+                    fd, best_previous_vertices.data() + prev_starts[cardinality],
+                    bin_coef(n, cardinality) * (n - cardinality)
+                  * sizeof(vertex_t)
+                );
+            });
+        }
+        first_cardinality = resumed_card;
+        is_next_big = ((big_cost_card - resumed_card) & 1) == 0;
     }
 
-    set_t best_set = (set_t) 0;
-    vertex_t best_left_end = (vertex_t) 0;
-    vertex_t best_left_prev = (vertex_t) 0;
-    vertex_t best_right_prev = (vertex_t) 0;
-    vertex_t *best_previous_vertex = best_previous_vertices.data();
-    for (int cardinality = 1; cardinality < max_card; ++cardinality) {
-        is_next_big = !is_next_big;
-        const bool do_store_prev =  cardinality > 1
-                                 && cardinality < max_card - 1;
+    // best[dst] and best_src[dst] over all dsts of a set from relax_dsts
+    // (inf if whole set is pruned), live_* are srcs not pruned yet,
+    // ranks of set's vertices and of the set with each added dst
+    struct SimdScratch {
+        alignas(64) T best[64];
+        alignas(64) min_plus::lane_idx_t<T> best_src[64];
+        alignas(64) T live_costs[64];
+        uint8_t live_srcs[64];
+        ExtensionRanks ranks;
+    };
 
-        T * const __restrict costs_next = is_next_big
-                            ? costs_big.data() : costs_small.data();
-        const T * const __restrict costs_prev = is_next_big
-                            ? costs_small.data() : costs_big.data();
-        const T * cost_prev = costs_prev;
+    // every extension of a pruned src is pruned as well, since its
+    // weight is at least the cheapest entry of the added dst, so pruned
+    // states are never written as such, only skipped when read
+    // @return num of live srcs, 0 iff whole set is pruned
+    const auto gather_live_srcs = [&calc_live_threshold] (
+        set_t set,
+        const T * cost_prev,
+        const T bound,
+        SimdScratch &scratch
+    ) [[ always_inline ]] {
+        const bound_t threshold = calc_live_threshold(set, bound);
+        int num_live = 0;
+        for ( ; set; set &= set - 1, ++cost_prev) {
+            // branchless, about half of srcs are pruned in big layers
+            scratch.live_srcs[num_live] = (uint8_t) __builtin_ctzll(set);
+            scratch.live_costs[num_live] = *cost_prev;
+            num_live += static_cast<bound_t>(*cost_prev) < threshold;
+        }
+        return num_live;
+    };
+
+    const auto relax_set_simd = [&] (
+        const int cardinality,
+        const T * const cost_prev,
+        SimdScratch &scratch,
+        const int num_live  // -1 iff not pruning
+    ) [[ always_inline, gnu::hot ]] {
+        if (num_live == 0) {
+            std::fill(scratch.best, scratch.best + n, inf);
+            std::fill(scratch.best_src, scratch.best_src + n, 0);
+        } else if (num_live > 0) {
+            relax_dsts(scratch.live_costs, scratch.live_srcs, num_live,
+                       flat_weights.data(), flat_stride, n,
+                       scratch.best, scratch.best_src);
+        } else {
+            relax_dsts(cost_prev, scratch.ranks.srcs, cardinality,
+                       flat_weights.data(), flat_stride, n,
+                       scratch.best, scratch.best_src);
+        }
+    };
 
-        ull set_idx = bin_coef[n][cardinality];
-        for (set_t set = (static_cast<set_t>(1) << cardinality) - 1;
+    // split sets of a layer into rank ranges, balanced by pool's workers,
+    // out-of-core each range's slice of the prev layer is the resident window
+    const auto calc_num_ranges = [&pool, is_out_of_core] (
+        const ull num_sets,
+        const int cardinality
+    ) -> ull {
+        constexpr ull min_sets_per_range = 1ULL << 10;
+        constexpr ull ranges_per_worker = 8ULL;
+        constexpr ull window_bytes = 1ULL << 26;
+        ull num_ranges = pool.size() == 1 ? 1ULL : std::max(1ULL, std::min(
+            num_sets / min_sets_per_range,
+            ranges_per_worker * pool.size()
+        ));
+        if (is_out_of_core) {
+            const ull layer_bytes = num_sets * cardinality * sizeof(T);
+            num_ranges = std::max(num_ranges,
+                                  (layer_bytes + window_bytes - 1) / window_bytes);
+        }
+        return std::max(1ULL, std::min(num_ranges, num_sets));
+    };
+    const auto get_range_start = [] (const ull num_sets,
+                                     const ull num_ranges,
+                                     const ull range_idx) -> ull {
+        return num_sets / num_ranges * range_idx
+             + std::min(range_idx, num_sets % num_ranges);
+    };
+
+    const auto process_layer_range = [&] (
+        const int cardinality,
+        const ull rank_start,
+        const ull num_sets,
+        const T * const __restrict costs_prev,
+        T * const __restrict costs_next,
+        vertex_t *best_previous_vertex
+    ) [[ gnu::hot ]] {
+        const bool do_store_prev = best_previous_vertex != nullptr;
+        const T * cost_prev = costs_prev + rank_start * cardinality;
+        SimdScratch scratch;
+
+        ull set_idx = num_sets;
+        for (set_t set = ranker.first(scratch.ranks, rank_start, cardinality);
              set_idx;
+             set = ranker.next(scratch.ranks, set),
              --set_idx, cost_prev += cardinality
         ) {
-            for (set_t dst_bits = ~set & all_vertices;
-                 dst_bits;
-                 dst_bits &= dst_bits - 1
-            ) {
-                const vertex_t dst = (vertex_t) __builtin_ctzll(dst_bits);
-                const set_t added_dst_to_set = add_to_set(set, dst);
-                ull next_rank = 0ULL;
+            int num_live = -1;
+            if (do_prune) {
+                num_live = gather_live_srcs(set, cost_prev, best_cost, scratch);
+            }
+            const bool is_relaxed = relax_dsts != nullptr || num_live == 0;
+            if (is_relaxed) {
+                relax_set_simd(cardinality, cost_prev, scratch, num_live);
+            }
+            int next_dst_rank = 0;
+            for (int dst = 0; dst < n; ++dst) {
+                if ((set >> dst) & 1) {
+                    ++next_dst_rank;
+                    continue;
+                }
                 T left_best_cost = inf;
                 vertex_t left_prev = (vertex_t) 0;
-                int v_idx = 0;
-                bool did_not_add = true;
-                for (set_t src_bits = set;
-                     src_bits;
-                     src_bits &= src_bits - 1, ++cost_prev
-                ) {
-                    const vertex_t src = (vertex_t) __builtin_ctzll(src_bits);
-                    const T weight = get_weight(src, dst);
-                    const bool is_lt = store_sum_iflt(*cost_prev, weight,
-                                                      left_best_cost);
-                    if constexpr (find_path) {
-                        if (is_lt) left_prev = src;
-                    }
-                    if (did_not_add && dst < src) {
-                        next_rank += bin_coef[dst][++v_idx];
-                        did_not_add = false;
+                if (is_relaxed) {
+                    left_best_cost = scratch.best[dst];
+                    left_prev = (vertex_t) scratch.best_src[dst];
+                } else {
+                    for (int i = 0; i < cardinality; ++i) {
+                        const vertex_t src = scratch.ranks.srcs[i];
+                        const T weight = get_weight(src, dst);
+                        const bool is_lt = store_sum_iflt(cost_prev[i], weight,
+                                                          left_best_cost);
+                        if constexpr (find_path) {
+                            if (is_lt) left_prev = src;
+                        }
                     }
-                    next_rank += bin_coef[src][++v_idx];
                 }
-                if (did_not_add) next_rank += bin_coef[dst][++v_idx];
-                cost_prev -= cardinality;
-
-                const int next_dst_rank = __builtin_popcountll(
-                    set & ((added_dst_to_set ^ set) - 1)
-                );
+                const ull next_rank = ranker.rankWith(scratch.ranks, dst,
+                                                      next_dst_rank);
                 *(costs_next + next_rank * (cardinality + 1) + next_dst_rank)
                         = left_best_cost;
                 if constexpr (find_path) {
                     if (do_store_prev) *(best_previous_vertex++) = left_prev;
                 }
             }
+        }
+    };
+
+    // compressed sets are encoded as whole blocks, so each set of the next
+    // layer pulls the costs of all its ends from its subsets at once,
+    // states are pruned when written instead of when read
+    const auto pull_layer_range = [&] (
+        const int cardinality,  // of the prev layer
+        const ull rank_start,  // of the next layer's sets
+        const ull num_sets,
+        const layer_t &prev_layer,
+        layer_t &next_layer,
+        vertex_t * const layer_prev_vertices
+    ) [[ gnu::hot ]] {
+        const int next_card = cardinality + 1;
+        SimdScratch scratch;
+        T subset_costs[64];
+        T costs[64];
 
-            // Gosper's hack:
-            const set_t c = set & -set;
-            const set_t r = set + c;
-            set = (((r ^ set) >> 2) / c) | r;
+        ull rank = rank_start;
+        ull set_idx = num_sets;
+        for (set_t set = ranker.first(scratch.ranks, rank_start, next_card);
+             set_idx;
+             set = ranker.next(scratch.ranks, set), --set_idx, ++rank
+        ) {
+            // rank(set - srcs[j]) = suffix[0] - suffix[j]
+            //                     + sum over i > j of C(srcs[i], i)
+            ull lowered = 0ULL;
+            for (int j = next_card - 1; j >= 0; --j) {
+                const vertex_t end = scratch.ranks.srcs[j];
+                const set_t subset = remove_from_set(set, end);
+                const ull subset_rank = scratch.ranks.suffix[0]
+                                      - scratch.ranks.suffix[j] + lowered;
+                lowered += bin_coef(end, j);
+                costs[j] = inf;
+                const vertex_t prev = find_best_ending(
+                    subset,
+                    prev_layer.block(subset_rank, cardinality, subset_costs),
+                    end, costs[j]
+                );
+                if constexpr (find_path) {
+                    if (layer_prev_vertices != nullptr) {
+                        // end - j vertices outside of subset are below end
+                        layer_prev_vertices[subset_rank * (n - cardinality)
+                                            + end - j] = prev;
+                    }
+                }
+            }
+            if (do_prune) {
+                const bound_t threshold = calc_live_threshold(set, best_cost);
+                for (int j = 0; j < next_card; ++j) {
+                    if (static_cast<bound_t>(costs[j]) >= threshold) {
+                        costs[j] = inf;
+                    }
+                }
+            }
+            next_layer.storeBlock(rank, next_card, costs);
         }
-    }
+    };
 
-    for (int cardinality = max_card; cardinality <= max_card; ++cardinality) {
+    for (int cardinality = first_cardinality;
+         cardinality < max_card;
+         ++cardinality
+    ) {
+        const LayerTimer layer_timer;
         is_next_big = !is_next_big;
-        const T * const __restrict costs_prev = is_next_big
-                                   ? costs_small.data() : costs_big.data();
-        const T * const __restrict costs_prev_end
-            = 1ULL + &(is_next_big ? costs_small.back() : costs_big.back());
-        const T * cost_prev = costs_prev;
+        layer_t &next_layer = is_next_big ? costs_big : costs_small;
+        const layer_t &prev_layer = is_next_big ? costs_small : costs_big;
+        // each set has its own (n - cardinality) prev vertices
+        vertex_t * const layer_prev_vertices
+            = stores_prevs(cardinality)
+            ? best_previous_vertices.data() + prev_starts[cardinality]
+            : nullptr;
+        // slices are not read again before being overwritten by next
+        // layers, except for the one path reconstruction starts from and
+        // the one being saved in the background
+        const bool do_discard = !checkpoint.isEnabled()
+                             && (!keeps_halves_layer
+                              || cardinality < max_card - 1);
 
-        ull set_idx = bin_coef[n][cardinality];
-        if constexpr (is_symmetric && !is_n_odd) {
-            set_idx /= 2;
+        if constexpr (is_compressed) {
+            // subsets are read at scattered ranks, ranges split next layer
+            const ull num_sets = bin_coef(n, cardinality + 1);
+            const ull num_ranges = calc_num_ranges(num_sets, cardinality);
+            pool.parallelFor(num_ranges, [&] (const ull range_idx, int) {
+                const ull start = get_range_start(num_sets, num_ranges,
+                                                  range_idx);
+                const ull end = get_range_start(num_sets, num_ranges,
+                                                range_idx + 1);
+                pull_layer_range(cardinality, start, end - start,
+                                 prev_layer, next_layer, layer_prev_vertices);
+            });
+            if (do_discard) {
+                prev_layer.discard(0ULL, bin_coef(n, cardinality), cardinality);
+            }
+        } else {
+            T * const costs_next = next_layer.data();
+            const T * const costs_prev = prev_layer.block(0ULL, cardinality,
+                                                          nullptr);
+            const ull num_sets = bin_coef(n, cardinality);
+            const ull num_ranges = calc_num_ranges(num_sets, cardinality);
+            pool.parallelFor(num_ranges, [&] (const ull range_idx, int) {
+                const ull start = get_range_start(num_sets, num_ranges,
+                                                  range_idx);
+                const ull end = get_range_start(num_sets, num_ranges,
+                                                range_idx + 1);
+                prev_layer.adviseSequential(start, end, cardinality);
+                process_layer_range(
+                    cardinality, start, end - start,
+                    costs_prev, costs_next,
+                    layer_prev_vertices == nullptr ? nullptr
+                        : layer_prev_vertices + start * (n - cardinality)
+                );
+                if (do_discard) prev_layer.discard(start, end, cardinality);
+                if (layer_prev_vertices != nullptr) {
+                    best_previous_vertices.evict(
+                        prev_starts[cardinality] + start * (n - cardinality),
+                        prev_starts[cardinality] + end * (n - cardinality)
+                    );
+                }
+            });
+        }
+
+        layer_timer.done(cardinality, bin_coef(n, cardinality));
+        store_prefix(next_layer, cardinality + 1);
+
+        // written while the next layer is computed, which only reads it
+        if (checkpoint.isEnabled()) {
+            const int next_card = cardinality + 1;
+            const ull num_next_sets = bin_coef(n, next_card);
+            layer_t * const saved_layer = &next_layer;
+            Checkpoint::write_fn write_prevs = nullptr;
+            if (layer_prev_vertices != nullptr) {
+                const size_t num_bytes = bin_coef(n, cardinality)
+                                       * (n - cardinality) * sizeof(vertex_t);
+                write_prevs = [layer_prev_vertices, num_bytes] (const int fd) {
+                    Checkpoint::writeAll(fd, layer_prev_vertices, num_bytes);
+                };
+            }
+            checkpoint.save(
+                next_card, checkpoint_bound,
+                [saved_layer, num_next_sets, next_card] (const int fd) {
+                    saved_layer->forEachRawBlock(
+                        num_next_sets, next_card,
+                        [fd] (char * const bytes, const size_t num_bytes) {
+                            Checkpoint::writeAll(fd, bytes, num_bytes);
+                        }
+                    );
+                },
+                write_prevs,
+                keeps_halves_layer && next_card == max_card
+            );
         }
-        for (set_t set = (static_cast<set_t>(1) << cardinality) - 1;
+    }
+
+    // layer of the merge's sets is the big one, halves' layer the small one
+    if (backward_run != nullptr) {
+        checkpoint.wait();
+        return best_cost;
+    }
+
+    struct MergeBest {
+        T cost;
+        set_t set = (set_t) 0;
+        vertex_t left_end = (vertex_t) 0;
+        vertex_t left_prev = (vertex_t) 0;
+        vertex_t right_prev = (vertex_t) 0;
+    };
+
+    const auto process_last_layer_range = [&] (
+        const int cardinality,
+        const ull rank_start,
+        const ull num_sets,
+        const layer_t &prev_layer,
+        const layer_t &right_layer,  // prev_layer unless bidirectional
+        MergeBest &merged
+    ) [[ gnu::hot ]] {
+        T best_cost = merged.cost;
+        set_t best_set = (set_t) 0;
+        vertex_t best_left_end = (vertex_t) 0;
+        vertex_t best_left_prev = (vertex_t) 0;
+        vertex_t best_right_prev = (vertex_t) 0;
+        const ull num_layer_sets = bin_coef(n, cardinality);
+        SimdScratch scratch;
+        T set_costs[64];
+        T right_costs[64];
+
+        ull rank = rank_start;
+        ull set_idx = num_sets;
+        for (set_t set = ranker.first(scratch.ranks, rank_start, cardinality);
              set_idx;
-             --set_idx, cost_prev += cardinality
+             set = ranker.next(scratch.ranks, set), --set_idx, ++rank
         ) {
+            const T * cost_prev = prev_layer.block(rank, cardinality,
+                                                   set_costs);
+            // bound only tightens within the merge, skip sets beyond it
+            int num_live = -1;
+            if (do_prune) {
+                num_live = gather_live_srcs(set, cost_prev, best_cost, scratch);
+                if (num_live == 0) continue;
+            }
+            if (relax_dsts != nullptr) {
+                relax_set_simd(cardinality, cost_prev, scratch, num_live);
+            }
             for (set_t dst_bits = ~set & all_vertices;
                  dst_bits;
                  dst_bits &= dst_bits - 1
@@ -294,21 +858,29 @@ T bellmanHeldKarp(
                 if constexpr (has_no_neg_weights) left_best_cost = best_cost;
                 else                              left_best_cost = inf;
                 vertex_t left_prev = (vertex_t) 0;
-                for (set_t src_bits = set;
-                     src_bits;
-                     src_bits &= src_bits - 1, ++cost_prev
-                ) {
-                    const vertex_t src = (vertex_t) __builtin_ctzll(src_bits);
-                    const T weight = get_weight(src, dst);
-                    const bool is_better = store_sum_iflt(*cost_prev, weight,
-                                                          left_best_cost);
-                    if constexpr (find_path) {
-                        if (is_better) left_prev = src;
+                if (relax_dsts != nullptr) {
+                    if (scratch.best[dst] < left_best_cost) {
+                        left_best_cost = scratch.best[dst];
+                        left_prev = (vertex_t) scratch.best_src[dst];
                     }
+                } else {
+                    for (set_t src_bits = set;
+                         src_bits;
+                         src_bits &= src_bits - 1, ++cost_prev
+                    ) {
+                        const vertex_t src = (vertex_t) __builtin_ctzll(src_bits);
+                        const T weight = get_weight(src, dst);
+                        const bool is_better = store_sum_iflt(
+                            *cost_prev, weight, left_best_cost
+                        );
+                        if constexpr (find_path) {
+                            if (is_better) left_prev = src;
+                        }
+                    }
+                    cost_prev -= cardinality;
                 }
-                cost_prev -= cardinality;
 
-                if constexpr (is_symmetric) {
+                if constexpr (is_merged) {
                     if constexpr (has_no_neg_weights) {
                         if (left_best_cost >= best_cost) continue;
                     }
@@ -318,23 +890,30 @@ T bellmanHeldKarp(
                     vertex_t right_prev = (vertex_t) 0;
                     if constexpr (is_n_odd) {  // compute dst connect second half
                         const set_t right_no_middle = remove_from_set(right, dst);
-                        const T * right_cost_prev = costs_prev
-                                                  + get_cost_start(right_no_middle);
+                        const T * right_cost_prev = right_layer.block(
+                            ranker.rank(right_no_middle),
+                            __builtin_popcountll(right_no_middle),
+                            right_costs
+                        );
                         if constexpr (has_no_neg_weights) {
                             other_half_cost -= left_best_cost;
                             if constexpr (std::is_floating_point_v<T>) {
                                 other_half_cost += 1.;  // avoid precision err
                             }
                         }
+                        // backward path leaves dst into right's vertices
                         right_prev = find_best_ending(
                             right_no_middle, right_cost_prev,
-                            dst, other_half_cost
+                            dst, other_half_cost, is_bidirectional
                         );
                     } else {  // n is even, already computed solution
                         const int prev_dst_rank
                             = __builtin_popcountll(right & ((1ULL << dst) - 1));
-                        const ull prev_rank = cost_prev - costs_prev + cardinality;
-                        other_half_cost = *(costs_prev_end - prev_rank + prev_dst_rank);
+                        // complement's rank mirrors set's within the layer
+                        other_half_cost = right_layer.entry(
+                            num_layer_sets - 1 - rank, cardinality,
+                            prev_dst_rank
+                        );
                     }
 
                     const bool is_new_best = store_sum_iflt(
@@ -349,8 +928,11 @@ T bellmanHeldKarp(
                         }
                     }
                 } else {  // asymmetric
+                    // a path has no edge back, weights has only n rows then
+                    const T closing_weight = end_in_starting_point
+                                           ? weights[dst][n] : (T) 0;
                     const bool is_new_best = store_sum_iflt(
-                        weights[dst][n], left_best_cost, best_cost
+                        closing_weight, left_best_cost, best_cost
                     );
                     if constexpr (find_path) {
                         if (is_new_best) [[ unlikely ]] {
@@ -360,53 +942,199 @@ T bellmanHeldKarp(
                     }
                 }
             }
+        }
+        merged = { best_cost, best_set, best_left_end,
+                   best_left_prev, best_right_prev };
+    };
+
+    set_t best_set = (set_t) 0;
+    vertex_t best_left_end = (vertex_t) 0;
+    vertex_t best_left_prev = (vertex_t) 0;
+    vertex_t best_right_prev = (vertex_t) 0;
+    bool is_found = false;
+    for (int cardinality = max_card; cardinality <= max_card; ++cardinality) {
+        const LayerTimer layer_timer;
+        is_next_big = !is_next_big;
+        const layer_t &prev_layer = is_next_big ? costs_small : costs_big;
+        const layer_t &right_layer = is_bidirectional ? backward.costs_big
+                                                      : prev_layer;
 
-            // Gosper's hack:
-            const set_t c = set & -set;
-            const set_t r = set + c;
-            set = (((r ^ set) >> 2) / c) | r;
+        ull num_sets = bin_coef(n, cardinality);
+        if constexpr (is_symmetric && !is_n_odd) {
+            num_sets /= 2;
         }
-    }
+        const ull num_ranges = calc_num_ranges(num_sets, cardinality);
+        std::vector<MergeBest> range_bests(num_ranges, { best_cost });
+        pool.parallelFor(num_ranges, [&] (const ull range_idx, int) {
+            const ull start = get_range_start(num_sets, num_ranges,
+                                              range_idx);
+            const ull end = get_range_start(num_sets, num_ranges,
+                                            range_idx + 1);
+            process_last_layer_range(
+                cardinality, start, end - start,
+                prev_layer, right_layer, range_bests[range_idx]
+            );
+        });
 
+        // ranges are in rank order, so first strict min matches serial run
+        for (const MergeBest &range_best : range_bests) {
+            if (range_best.cost < best_cost) {
+                is_found = true;
+                best_cost = range_best.cost;
+                best_set = range_best.set;
+                best_left_end = range_best.left_end;
+                best_left_prev = range_best.left_prev;
+                best_right_prev = range_best.right_prev;
+            }
+        }
+        layer_timer.done(cardinality, num_sets);
+    }
+    // finished run leaves nothing to resume
+    checkpoint.clear();
+    if constexpr (is_bidirectional) {
+        Checkpoint(checkpoint_dir, "bhk_backward", "").clear();
+    }
     if constexpr (!find_path) {
         return best_cost;
     }
+    if (!is_found) {
+        solution.clear();
+        return best_cost;
+    }
 
-    const auto get_set_ordinal = [&bin_coef] (const set_t set) -> ull {
-        ull prev_rank = 0ULL;
-        int v_idx = 0;
-        for (set_t src_bits = set; src_bits; src_bits &= src_bits - 1) {
-            prev_rank += bin_coef[__builtin_ctzll(src_bits)][++v_idx];
-        }
-        return prev_rank;
-    };
-
-    const T * const costs_prev = is_next_big ? costs_big.data()
-                                             : costs_small.data();
+    // layer of sets one short of the merged ones
+    const layer_t &halves_layer = is_next_big ? costs_big : costs_small;
+    if (recompute_path) {  // halves are solved at their own memory
+        costs_big.release();
+        costs_small.release();
+        backward.costs_big.release();
+    }
     const auto get_prev = [&] (
+        const LayerBuffer<vertex_t> &previous_vertices,
         const int card_with_ending,
         const set_t with_ending,
         const set_t without_ending
     ) -> vertex_t {
         const ull segment_start = prev_starts[card_with_ending - 1];
-        const ull set_rank = get_set_ordinal(without_ending)
+        const ull set_rank = ranker.rank(without_ending)
                            * (n - (card_with_ending - 1));
         const int ending_rank = __builtin_popcountll(
             (~without_ending) & ((with_ending ^ without_ending) - 1)
         );
-        return best_previous_vertices
-            [segment_start + set_rank + ending_rank];
+        return previous_vertices[segment_start + set_rank + ending_rank];
     };
 
+    // prefixes are walked back from their ends, previous vertices of the
+    // sets of max_card are not stored but found in the layer below them
+    if (prefixes != nullptr) {
+        for (int cardinality = 1; cardinality < n; ++cardinality) {
+            std::vector<vertex_t> &prefix_path = prefixes->paths[cardinality];
+            set_t half = (static_cast<set_t>(1) << cardinality) - 1;
+            vertex_t end = prefix_ends[cardinality];
+            prefix_path.assign(1, end);
+            for (int card = cardinality; card >= 2; --card) {
+                const set_t next_half = remove_from_set(half, end);
+                if (card == 2) {
+                    end = (vertex_t) __builtin_ctzll(next_half);
+                } else if (card == max_card) {
+                    T half_costs[64];
+                    T cost = inf;
+                    end = find_best_ending(
+                        next_half,
+                        halves_layer.block(ranker.rank(next_half), card - 1,
+                                           half_costs),
+                        end, cost
+                    );
+                } else {
+                    end = get_prev(best_previous_vertices, card, half,
+                                   next_half);
+                }
+                prefix_path.push_back(end);
+                half = next_half;
+            }
+            std::reverse(prefix_path.begin(), prefix_path.end());
+        }
+    }
+
     solution.resize(end_in_starting_point ? n + 2 : n);
     std::span<vertex_t> path(solution.data() + end_in_starting_point, n);
+    // path[path_idx] to the end of the path in given dir is the cheapest
+    // path from start through half up to path[path_idx - dir], which is
+    // the tour of an asymmetric instance closing in path[path_idx - dir],
+    // backward halves are tours of the transposed instance
+    const auto recompute_half = [&] (const set_t half, const int path_idx,
+                                     const int dir, const bool is_backward) {
+        const int num_vertices = __builtin_popcountll(half);
+        std::vector<vertex_t> vertices;
+        vertices.reserve(num_vertices);
+        for (set_t bits = half; bits; bits &= bits - 1) {
+            vertices.push_back((vertex_t) __builtin_ctzll(bits));
+        }
+        if (num_vertices <= 1) {
+            if (num_vertices == 1) path[path_idx] = vertices[0];
+            return;
+        }
+        const vertex_t closing = path[path_idx - dir];
+        const auto get_half_weight = [&] (const int s, const int d) {
+            return is_backward ? weights[d][s] : weights[s][d];
+        };
+        std::vector<std::vector<T>> half_weights(
+            num_vertices + 1, std::vector<T>(num_vertices + 1, (T) 0)
+        );
+        for (int i = 0; i < num_vertices; ++i) {
+            for (int j = 0; j < num_vertices; ++j) {
+                half_weights[i][j] = get_half_weight(vertices[i],
+                                                     vertices[j]);
+            }
+            half_weights[i][num_vertices] = get_half_weight(vertices[i],
+                                                            closing);
+            half_weights[num_vertices][i] = end_in_starting_point
+                                          ? get_half_weight(n, vertices[i])
+                                          : (T) 0;
+        }
+        std::vector<vertex_t> half_path;
+        // its layers are a part of reconstructing the path
+        const LayerObserverPause pause;
+        // parity of the half matters only if it is merged from both ends
+        const auto solve_half = [&] <bool is_half_odd> () {
+            bellmanHeldKarp<T, false, is_half_odd, has_no_neg_weights, true,
+                            vertex_t, set_t, T, is_bidirectional>(
+                half_path, half_weights, true, inf,
+                num_threads, layers_dir, true
+            );
+        };
+        if (is_bidirectional && (num_vertices & 1)) {
+            solve_half.template operator()<true>();
+        } else {
+            solve_half.template operator()<false>();
+        }
+        // { num_vertices, first after start, ..., last before closing, ... }
+        for (int i = 0; i < num_vertices; ++i) {
+            path[dir < 0 ? i : n - 1 - i] = vertices[half_path[i + 1]];
+        }
+    };
+
     const auto reconstruct_half = [&] (set_t half, int path_idx, const int dir) {
         if (path_idx < 0 || path_idx >= n) return;
-        const T * const cost_prev = costs_prev + get_cost_start(half);
+        // right half of a bidirectional run is a path of the backward one
+        const bool is_backward = is_bidirectional && dir > 0;
+        if (recompute_path) {
+            recompute_half(half, path_idx, dir, is_backward);
+            return;
+        }
+        const layer_t &layer = is_backward ? backward.costs_small
+                                           : halves_layer;
+        const LayerBuffer<vertex_t> &previous_vertices
+            = is_backward ? backward.previous_vertices
+                          : best_previous_vertices;
+        T half_costs[64];
+        const T * const cost_prev = layer.block(
+            ranker.rank(half), __builtin_popcountll(half), half_costs
+        );
         T cost = inf;
         path[path_idx] = find_best_ending(
             half, cost_prev,
-            path[path_idx - dir], cost
+            path[path_idx - dir], cost, is_backward
         );
         int cardinality = __builtin_popcountll(half);
         for (path_idx += dir;
@@ -415,7 +1143,8 @@ T bellmanHeldKarp(
         ) {
             const vertex_t cur_end = path[path_idx - dir];
             const set_t next_half = remove_from_set(half, cur_end);
-            path[path_idx] = get_prev(cardinality, half, next_half);
+            path[path_idx] = get_prev(previous_vertices, cardinality,
+                                      half, next_half);
             half = next_half;
         }
         if (path_idx >= 0 && path_idx < n) {
@@ -424,7 +1153,7 @@ T bellmanHeldKarp(
         }
     };
 
-    set_t left = is_symmetric ? best_set : all_vertices;
+    set_t left = is_merged ? best_set : all_vertices;
     set_t right = ~left & all_vertices;
 
     // reconstruct left half
@@ -438,7 +1167,7 @@ T bellmanHeldKarp(
     }
 
     // reconstruct right half
-    if constexpr (is_symmetric) {
+    if constexpr (is_merged) {
         int path_right_idx = max_card + 1;
         if constexpr (is_n_odd) {
             path[path_right_idx++] = best_right_prev;
@@ -453,7 +1182,7 @@ T bellmanHeldKarp(
     return best_cost;
 }
 
-template<typename T, typename vertex_t, typename set_t>
+template<typename T, typename vertex_t, typename set_t, typename delta_t>
 struct BHKDispatcher {
     template<bool is_symmetric, bool is_n_odd,
              bool has_no_neg_weights, bool find_path>
@@ -461,41 +1190,94 @@ struct BHKDispatcher {
         std::vector<vertex_t> &solution,
         const std::vector<std::vector<T>> &weights,
         const bool end_in_starting_point,
-        T best_cost
+        T best_cost,
+        const int num_threads,
+        const std::string &layers_dir,
+        const bool recompute_path,
+        const bool bidirectional,
+        const std::string &checkpoint_dir
     ) {
+        if constexpr (!is_symmetric) {
+            if (bidirectional) {
+                return bellmanHeldKarp<
+                    T, is_symmetric, is_n_odd, has_no_neg_weights,
+                    find_path, vertex_t, set_t, delta_t, true
+                >(solution, weights, end_in_starting_point, best_cost,
+                  num_threads, layers_dir, recompute_path, checkpoint_dir);
+            }
+        }
         return bellmanHeldKarp<
             T, is_symmetric, is_n_odd, has_no_neg_weights,
-            find_path, vertex_t, set_t
-        >(solution, weights, end_in_starting_point, best_cost);
+            find_path, vertex_t, set_t, delta_t
+        >(solution, weights, end_in_starting_point, best_cost, num_threads,
+          layers_dir, recompute_path, checkpoint_dir);
     }
 };
 
 }  // detail namesspace
 
 
+/// @param bidirectional - asymmetric instance is solved from both ends,
+///                        backward layers the merge reads are kept too
 /// @return (num mem locations for path, num mem locs for costs)
 std::pair<uint64_t, uint64_t> calcSpaceNeeded(
     int n,
     const bool search_cycle,
     const bool is_symmetric,
-    const bool cost_only=true
+    const bool cost_only=true,
+    const bool bidirectional=false
 ) {
     if (search_cycle) n--;
     if (n <= 1) return { 1ULL, 1ULL };
-    const int max_card = is_symmetric ? std::max(1, n / 2) : n - 1;
-    const auto binomials = detail::binomialsMatr(n, max_card);
+    const bool is_bidirectional = bidirectional && !is_symmetric;
+    const bool is_merged = is_symmetric || is_bidirectional;
+    const int max_card = is_merged ? std::max(1, n / 2) : n - 1;
+    const detail::Binomials binomials(n, max_card);
     const int big_cost_card = n / 2;
-    const int small_cost_card = n <= 2 ? 0 : n / 2 + (is_symmetric ? -1 : 1);
-    const uint64_t costs = binomials[n][small_cost_card] * small_cost_card
-                         + binomials[n][big_cost_card] * big_cost_card;
+    const int small_cost_card = n <= 2 ? 0 : n / 2 + (is_merged ? -1 : 1);
+    const uint64_t big_costs = binomials(n, big_cost_card) * big_cost_card;
+    const uint64_t small_costs = binomials(n, small_cost_card)
+                               * small_cost_card;
+    uint64_t costs = small_costs + big_costs;
+    if (is_bidirectional) costs += big_costs + (cost_only ? 0ULL : small_costs);
     if (cost_only) return { 0ULL, costs };
     const uint64_t path
-        = detail::prevVertexStarts(n, max_card, binomials).back();
+        = detail::prevVertexStarts(n, max_card, binomials).back()
+        * (is_bidirectional ? 2ULL : 1ULL);
     return { path, costs };
 }
 
+/// @return num of sets in all kept cost layers, each has its own base when
+///         layers are compressed
+uint64_t calcNumCostSets(int n, const bool search_cycle,
+                         const bool is_symmetric, const bool cost_only=true,
+                         const bool bidirectional=false) {
+    if (search_cycle) n--;
+    if (n <= 1) return 1ULL;
+    const bool is_bidirectional = bidirectional && !is_symmetric;
+    const bool is_merged = is_symmetric || is_bidirectional;
+    const int big_cost_card = n / 2;
+    const int small_cost_card = n <= 2 ? 0 : n / 2 + (is_merged ? -1 : 1);
+    const uint64_t big_sets = detail::comb(n, big_cost_card);
+    const uint64_t small_sets = detail::comb(n, small_cost_card);
+    uint64_t num_sets = small_sets + big_sets;
+    if (is_bidirectional) num_sets += big_sets + (cost_only ? 0ULL : small_sets);
+    return num_sets;
+}
+
+/// @param bidirectional - asymmetric instances are solved from both ends
+///                        up to n / 2 and merged, for about half of the
+///                        stored previous vertices and smaller recomputed
+///                        halves, at more memory for costs
+/// @param checkpoint_dir - if not empty finished layers are saved there in
+///                         the background, a killed run restarted with
+///                         the same arguments continues from the last one
+/// @tparam delta_t - if narrower than T, layers store narrow deltas from
+///                   a base per set, or costs rounded to a half float,
+///                   see detail::CostLayer
 /// @return (min_cost, vertices making up the path)
-template<typename T, typename vertex_t=uint8_t, typename set_t=uint64_t>
+template<typename T, typename vertex_t=uint8_t, typename set_t=uint64_t,
+         typename delta_t=T>
 T bellmanHeldKarp(
     std::vector<vertex_t> &solution,
     const std::vector<std::vector<T>> &weights,
@@ -503,18 +1285,57 @@ T bellmanHeldKarp(
     const bool is_symmetric,
     T best_cost = std::numeric_limits<T>::max(),
     bool has_no_neg_weights=true,
-    bool find_path=true
+    bool find_path=true,
+    const int num_threads=1,
+    const std::string &layers_dir="",
+    const bool recompute_path=false,
+    const bool bidirectional=false,
+    const std::string &checkpoint_dir=""
 ) {
     const int n = end_in_starting_point ? weights.size() - 1
                                         : weights.size();
     const bool is_n_odd = n & 1;
 
-    using Dispatcher = detail::BHKDispatcher<T, vertex_t, set_t>;
+    // instances with mostly forbidden edges carry only reachable states,
+    // unless they turn out dense after all
+    if ( layers_dir.empty() && !recompute_path && !bidirectional
+      && checkpoint_dir.empty()
+      && detail::sparse::edgeDensity(weights)
+         <= detail::sparse::max_edge_density
+    ) {
+        T sparse_cost = best_cost;
+        if (detail::sparse::solve<T, vertex_t, set_t>(
+                solution, weights, end_in_starting_point, sparse_cost,
+                has_no_neg_weights, find_path)
+        ) {
+            return sparse_cost;
+        }
+    }
+
+    // small single-threaded in-memory solves go to solvers for fixed n
+    const bool is_merged = is_symmetric || bidirectional;
+    if ( std::is_same_v<T, delta_t>
+      && num_threads == 1 && layers_dir.empty() && !recompute_path
+      && checkpoint_dir.empty()
+      && (!is_merged || n <= detail::fixed::max_symmetric_n)
+    ) {
+        const auto solve_fixed = detail::fixed::selectSolver<T, vertex_t>(
+            n, find_path
+        );
+        if (solve_fixed != nullptr) {
+            return solve_fixed(solution, weights, end_in_starting_point,
+                               best_cost);
+        }
+    }
+
+    using Dispatcher = detail::BHKDispatcher<T, vertex_t, set_t, delta_t>;
     #define BHK_CALL(sym, odd, noneg, path) \
         if ( is_symmetric == sym && is_n_odd == odd \
           && has_no_neg_weights == noneg && find_path == path) { \
             return Dispatcher::template call<sym, odd, noneg, path>( \
-                solution, weights, end_in_starting_point, best_cost ); \
+                solution, weights, end_in_starting_point, best_cost, \
+                num_threads, layers_dir, recompute_path, bidirectional, \
+                checkpoint_dir ); \
         }
 
     BHK_CALL(true, true, true, true);
@@ -539,5 +1360,100 @@ T bellmanHeldKarp(
     return (T) 0;  // should never happen
 }
 
+/**
+ * @brief Optimal costs, and paths, of all prefixes of the vertices, from 1
+ *        to all of them, in a single run over all of them: states of the
+ *        first m vertices are the first of their layers in colex order and
+ *        depend on no later vertex, so every layer yields a prefix.
+ *        Nothing is pruned and halves are not merged, so it costs about a
+ *        single asymmetric run of all the vertices, not a run per prefix.
+ * @param end_in_starting_point - TSP of each prefix, its tour starts and
+ *                                ends in vertex 0, else SHP
+ * @param paths - if not nullptr, (*paths)[m] is an optimal path of the
+ *                first m vertices, as solution of bellmanHeldKarp
+ * @tparam delta_t - storage of cost layers, see detail::CostLayer
+ * @return costs[m] is the min cost of the first m vertices, costs[0] = 0
+ */
+template<typename T, typename vertex_t=uint8_t, typename set_t=uint64_t,
+         typename delta_t=T>
+std::vector<T> bellmanHeldKarpPrefixes(
+    const std::vector<std::vector<T>> &weights,
+    const bool end_in_starting_point,
+    std::vector<std::vector<vertex_t>> * const paths = nullptr,
+    const int num_threads = 1,
+    const std::string &layers_dir = ""
+) {
+    const int num_points = weights.size();
+    std::vector<T> costs(num_points + 1, (T) 0);
+    if (paths != nullptr) paths->assign(num_points + 1, {});
+    if (num_points == 0) return costs;
+    if (end_in_starting_point) {
+        costs[1] = weights[0][0];
+        if (paths != nullptr) (*paths)[1] = { 0, 0 };
+    } else if (paths != nullptr) {
+        (*paths)[1] = { 0 };
+    }
+    // solver's start is its last vertex, vertex 0 is moved there to be a
+    // part of every prefix
+    const int n = end_in_starting_point ? num_points - 1 : num_points;
+    const auto to_point = [&] (const int v) -> vertex_t {
+        return (vertex_t) (end_in_starting_point ? (v + 1) % num_points : v);
+    };
+    if (n <= 1) {
+        if (n == 1 && end_in_starting_point) {
+            costs[2] = weights[0][1] + weights[1][0];
+            if (paths != nullptr) (*paths)[2] = { 0, 1, 0 };
+        }
+        return costs;
+    }
+    std::vector<std::vector<T>> rotated;
+    if (end_in_starting_point) {
+        rotated.assign(num_points, std::vector<T>(num_points));
+        for (int src = 0; src < num_points; ++src) {
+            for (int dst = 0; dst < num_points; ++dst) {
+                rotated[src][dst] = weights[to_point(src)][to_point(dst)];
+            }
+        }
+    }
+
+    detail::PrefixStates<T, vertex_t> prefixes;
+    std::vector<vertex_t> solution;
+    const auto solve = [&] <bool is_n_odd, bool find_path> () {
+        return detail::bellmanHeldKarp<
+            T, false, is_n_odd, true, find_path, vertex_t, set_t, delta_t
+        >(solution, end_in_starting_point ? rotated : weights,
+          end_in_starting_point, std::numeric_limits<T>::max(),
+          num_threads, layers_dir, false, "", nullptr, &prefixes);
+    };
+    const bool is_n_odd = n & 1;
+    T cost;
+    if (paths != nullptr) {
+        cost = is_n_odd ? solve.template operator()<true, true>()
+                        : solve.template operator()<false, true>();
+    } else {
+        cost = is_n_odd ? solve.template operator()<true, false>()
+                        : solve.template operator()<false, false>();
+    }
+
+    // prefix of m vertices holds m - 1 of solver's if closed into start
+    const int num_start = end_in_starting_point;
+    for (int cardinality = 1; cardinality < n; ++cardinality) {
+        costs[cardinality + num_start] = prefixes.costs[cardinality];
+    }
+    costs[num_points] = cost;
+    if (paths == nullptr) return costs;
+    for (int cardinality = 1; cardinality < n; ++cardinality) {
+        std::vector<vertex_t> &path = (*paths)[cardinality + num_start];
+        path.assign(num_start, (vertex_t) 0);
+        for (const vertex_t v : prefixes.paths[cardinality]) {
+            path.push_back(to_point(v));
+        }
+        if (end_in_starting_point) path.push_back((vertex_t) 0);
+    }
+    std::vector<vertex_t> &path = (*paths)[num_points];
+    for (const vertex_t v : solution) path.push_back(to_point(v));
+    return costs;
+}
+
 
 #endif
@@ -0,0 +1,362 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <variant>
+#include <utility>
+#include <sys/resource.h>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include "dtype_selector.hpp"
+#include "scaler.hpp"
+#include "bellman_held_karp.hpp"
+#include "layer_observer.hpp"
+#include "../common/random.hpp"
+#include "../common/timing.hpp"
+#include "../common/problem_loader.hpp"
+
+
+/// @brief Measurements of a single configuration, times of its best run.
+struct BenchResult {
+    double best_ms = std::numeric_limits<double>::max();
+    double avg_ms = 0.;
+    double layers_ms = 0.;
+    unsigned long long relaxations = 0ULL;  // (set, dst, src) triples
+    long peak_rss_kb = 0L;
+    // above RSS at the start, tables kept by earlier configurations, e.g.
+    // per thread ones of solvers for fixed n, are in peak_rss_kb too
+    long rss_growth_kb = 0L;
+    double cost = 0.;
+    std::vector<detail::LayerStats> layers;
+};
+
+template<typename cost_t>
+std::string costTypeName();
+
+/// @return asymmetric instance, each direction of an edge stretched by up
+///         to a quarter of its length
+std::vector<std::vector<double>> makeAsymmetric(
+    const std::vector<std::vector<double>> &distances,
+    const unsigned int seed
+);
+
+/// @brief Peak RSS of the process is reset to its current RSS, if the
+///        kernel allows it, so each configuration measures its own peak.
+/// @return current RSS [kB]
+long resetPeakRss();
+
+/// @return peak RSS [kB] since the last reset
+long readPeakRss();
+
+template<typename cost_t>
+BenchResult benchmark(
+    const std::vector<std::vector<double>> &distances,
+    const bool is_searching_for_cycle,
+    const bool is_symmetric,
+    const bool find_path,
+    const int num_threads,
+    const int num_reruns
+);
+
+void writeResult(
+    std::ostream &out,
+    const BenchResult &result,
+    const std::string &cost_t_name,
+    const int num_points,
+    const bool is_searching_for_cycle,
+    const bool is_symmetric,
+    const bool find_path,
+    const int num_threads,
+    const int num_reruns
+);
+
+
+/**
+ * Sweeps num of points, every cost_t of detail::cost_t_variant, symmetric
+ * and asymmetric instances, TSP and SHP, path and cost only, and writes a
+ * CSV row per configuration, to compare builds and catch regressions of
+ * the DP, see commands/bellman_held_karp/compare_benchmarks.py.
+ * Nothing is pruned, every run does all the work of its configuration.
+ */
+int main(const int argc, const char **argv)
+{
+    using point_t = double;
+    using distance_t = double;
+
+    const std::string input_point_format = "%lf %lf\n";
+    const int min_num_points = argc < 2 ? 12 : std::atoi(argv[1]);
+    const int max_num_points = argc < 3 ? 20 : std::atoi(argv[2]);
+    const std::string path_in_file = argc < 4
+                                   ? "../problems/263.txt"
+                                   : argv[3];
+    const std::string path_out_file = argc < 5
+                                    ? "bellman_held_karp_bench.csv"
+                                    : argv[4];
+    const int num_reruns = argc < 6 ? 3 : std::max(1, std::atoi(argv[5]));
+    // 0 to use all hardware threads
+    const int num_threads = argc < 7 ? 1 : std::atoi(argv[6]);
+    const unsigned int seed = argc < 8 ? 1U : std::atoi(argv[7]);
+
+    try {
+        std::ofstream out(path_out_file);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open output file: "
+                                   + path_out_file);
+        }
+        out << "num_points,cost_t,symmetric,problem,find_path,threads,runs,"
+               "best_ms,avg_ms,layers_ms,relaxations,relaxations_per_s,"
+               "cycles_per_relaxation,peak_rss_kb,rss_growth_kb,cost,layer_ms"
+            << std::endl;
+
+        for (int num_points = min_num_points;
+             num_points <= max_num_points;
+             ++num_points
+        ) {
+            const std::vector<std::vector<distance_t>> symmetric
+                = prloader::loadDistances<point_t, distance_t>(
+                    path_in_file, input_point_format, num_points
+                );
+            if (static_cast<int>(symmetric.size()) < num_points) {
+                throw std::runtime_error("Input file has less than "
+                                       + std::to_string(num_points)
+                                       + " points.");
+            }
+            const std::vector<std::vector<distance_t>> asymmetric
+                = makeAsymmetric(symmetric, seed);
+
+            const auto sweep = [&] <typename cost_t> () {
+                for (const bool is_symmetric : { true, false }) {
+                    for (const bool is_cycle : { true, false }) {
+                        for (const bool find_path : { true, false }) {
+                            const BenchResult result = benchmark<cost_t>(
+                                is_symmetric ? symmetric : asymmetric,
+                                is_cycle, is_symmetric, find_path,
+                                num_threads, num_reruns
+                            );
+                            writeResult(out, result, costTypeName<cost_t>(),
+                                        num_points, is_cycle, is_symmetric,
+                                        find_path, num_threads, num_reruns);
+                            writeResult(std::cout, result,
+                                        costTypeName<cost_t>(), num_points,
+                                        is_cycle, is_symmetric, find_path,
+                                        num_threads, num_reruns);
+                        }
+                    }
+                }
+            };
+            [&] <size_t... Is> (std::index_sequence<Is...>) {
+                (sweep.template operator()<
+                    std::variant_alternative_t<Is, detail::cost_t_variant>
+                >(), ...);
+            } (std::make_index_sequence<
+                std::variant_size_v<detail::cost_t_variant>
+            >());
+        }
+
+    } catch (const std::bad_alloc &err) {
+        std::cout << "OS failed to allocate space." << std::endl;
+        std::cerr << "OS failed to allocate space." << std::endl;
+        return -2;
+
+    } catch (const std::exception &err) {
+        std::cout << "err: " << err.what() << std::endl;
+        std::cerr << "err: " << err.what() << std::endl;
+        return -3;
+
+    } catch (...) {
+        std::cout << "Unknown error." << std::endl;
+        std::cerr << "Unknown error." << std::endl;
+        return -4;
+    }
+
+    return 0;
+}
+
+template<typename cost_t>
+BenchResult benchmark(
+    const std::vector<std::vector<double>> &distances,
+    const bool is_searching_for_cycle,
+    const bool is_symmetric,
+    const bool find_path,
+    const int num_threads,
+    const int num_reruns
+) {
+    using vertex_t = uint8_t;
+    const int num_points = distances.size();
+    const int num_edges = is_searching_for_cycle ? num_points
+                                                 : num_points - 1;
+    double min_dist = std::numeric_limits<double>::max();
+    double max_dist = 0.;
+    for (int i = 0; i < num_points; ++i) {
+        for (int j = 0; j < num_points; ++j) {
+            if (i == j) continue;
+            min_dist = std::min(min_dist, distances[i][j]);
+            max_dist = std::max(max_dist, distances[i][j]);
+        }
+    }
+    // half floats are stored rounded, summed in float
+    using value_t = detail::compute_t<cost_t>;
+    // nothing is pruned, so any path has to fit, not just optimal ones
+    std::vector<std::vector<value_t>> weights;
+    if constexpr (detail::is_half_float_v<cost_t>) {
+        double scaling_factor = 1.;
+        weights = recastMatrix<value_t>(scaleAndNormalize<cost_t, double>(
+            distances, min_dist, (max_dist - min_dist) * num_edges,
+            1e12, false, scaling_factor
+        ));
+    } else if (std::is_floating_point_v<cost_t> || max_dist <= min_dist) {
+        weights = recastMatrix<cost_t>(distances);
+    } else {
+        double scaling_factor = 1.;
+        weights = scaleAndNormalize<cost_t, double>(
+            distances, min_dist, (max_dist - min_dist) * num_edges,
+            1e12, true, scaling_factor
+        );
+    }
+
+    BenchResult result;
+    std::vector<detail::LayerStats> layers;
+    detail::on_layer_done = [&layers] (const detail::LayerStats &stats) {
+        layers.push_back(stats);
+    };
+    const long start_rss_kb = resetPeakRss();
+    for (int run = 0; run < num_reruns; ++run) {
+        layers.clear();
+        std::vector<vertex_t> path;
+        const auto start_time = std::chrono::steady_clock::now();
+        const value_t cost = bellmanHeldKarp<value_t, vertex_t,
+                                             uint64_t, cost_t>(
+            path, weights, is_searching_for_cycle, is_symmetric,
+            std::numeric_limits<value_t>::max(),
+            true,  // normalized
+            find_path, num_threads
+        );
+        const std::chrono::duration<double, std::milli> elapsed
+            = std::chrono::steady_clock::now() - start_time;
+        result.avg_ms += elapsed.count() / num_reruns;
+        if (elapsed.count() < result.best_ms) {
+            result.best_ms = elapsed.count();
+            result.cost = static_cast<double>(cost);
+            result.layers = layers;
+        }
+    }
+    result.peak_rss_kb = readPeakRss();
+    result.rss_growth_kb = std::max(0L, result.peak_rss_kb - start_rss_kb);
+    detail::on_layer_done = nullptr;
+
+    // each set of a layer is extended by each vertex outside it from each
+    // of its own, n excludes the starting point of a cycle
+    const int n = is_searching_for_cycle ? num_points - 1 : num_points;
+    for (const detail::LayerStats &layer : result.layers) {
+        result.layers_ms += layer.seconds * 1e3;
+        result.relaxations += layer.num_sets * layer.cardinality
+                            * (n - layer.cardinality);
+    }
+    return result;
+}
+
+void writeResult(
+    std::ostream &out,
+    const BenchResult &result,
+    const std::string &cost_t_name,
+    const int num_points,
+    const bool is_searching_for_cycle,
+    const bool is_symmetric,
+    const bool find_path,
+    const int num_threads,
+    const int num_reruns
+) {
+    // rates are over time spent in layers, the rest is setup and the path
+    const double layers_s = result.layers_ms / 1e3;
+    const double relaxations_per_s = layers_s > 0.
+                                   ? result.relaxations / layers_s : 0.;
+    // reference cycles of the TSC, not of the core's current clock
+    const double cycles_per_relaxation = result.relaxations > 0ULL
+        ? 1. * timing::msToCycles(result.layers_ms) / result.relaxations
+        : 0.;
+    std::ostringstream layer_ms;
+    for (const detail::LayerStats &layer : result.layers) {
+        if (layer_ms.tellp() > 0) layer_ms << ';';
+        layer_ms << layer.cardinality << ':' << layer.seconds * 1e3;
+    }
+    out << num_points << ','
+        << cost_t_name << ','
+        << is_symmetric << ','
+        << (is_searching_for_cycle ? "tsp" : "shp") << ','
+        << find_path << ','
+        << threading::resolveNumThreads(num_threads) << ','
+        << num_reruns << ','
+        << result.best_ms << ','
+        << result.avg_ms << ','
+        << result.layers_ms << ','
+        << result.relaxations << ','
+        << relaxations_per_s << ','
+        << cycles_per_relaxation << ','
+        << result.peak_rss_kb << ','
+        << result.rss_growth_kb << ','
+        << std::setprecision(17) << result.cost << std::setprecision(6) << ','
+        << layer_ms.str()
+        << std::endl;
+}
+
+std::vector<std::vector<double>> makeAsymmetric(
+    const std::vector<std::vector<double>> &distances,
+    const unsigned int seed
+) {
+    boost::random::mt19937 psrng = random::initPSRNG(seed);
+    boost::random::uniform_real_distribution<double> stretch(1., 1.25);
+    std::vector<std::vector<double>> asymmetric = distances;
+    for (auto &row : asymmetric) {
+        for (double &distance : row) distance *= stretch(psrng);
+    }
+    return asymmetric;
+}
+
+/// @return value [kB] of the field of /proc/self/status, -1 if missing
+long readProcStatus(const std::string &field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0) {
+            return std::atol(line.c_str() + field.size());
+        }
+    }
+    return -1L;
+}
+
+long resetPeakRss() {
+    {
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        if (clear_refs.is_open()) clear_refs << "5";
+    }
+    return std::max(0L, readProcStatus("VmRSS:"));
+}
+
+long readPeakRss() {
+    const long peak_rss_kb = readProcStatus("VmHWM:");
+    if (peak_rss_kb >= 0L) return peak_rss_kb;
+    // without procfs only the peak of the whole process is known
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+template<typename cost_t>
+std::string costTypeName() {
+    if constexpr (std::is_same_v<cost_t, uint8_t>) return "uint8_t";
+    else if constexpr (std::is_same_v<cost_t, uint16_t>) return "uint16_t";
+    else if constexpr (std::is_same_v<cost_t, uint32_t>) return "uint32_t";
+    else if constexpr (std::is_same_v<cost_t, uint64_t>) return "uint64_t";
+    else if constexpr (std::is_same_v<cost_t, int8_t>) return "int8_t";
+    else if constexpr (std::is_same_v<cost_t, int16_t>) return "int16_t";
+    else if constexpr (std::is_same_v<cost_t, int32_t>) return "int32_t";
+    else if constexpr (std::is_same_v<cost_t, int64_t>) return "int64_t";
+    else if constexpr (std::is_same_v<cost_t, float>) return "float";
+    else if constexpr (std::is_same_v<cost_t, double>) return "double";
+    else if constexpr (detail::is_half_float_v<cost_t>) return cost_t::name;
+    else return typeid(cost_t).name();
+}
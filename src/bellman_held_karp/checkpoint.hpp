@@ -0,0 +1,236 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <future>
+#include <functional>
+#include <filesystem>
+#include <stdexcept>
+#include <limits>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace detail {
+
+/**
+ * @brief Resumable state of a run kept in a directory: the last finished
+ *        cost layer, previous vertices of all layers before it and a
+ *        manifest naming the layer, written last, so it only ever names
+ *        complete files.
+ *        Every file is written to a temporary one, synced and renamed.
+ *        Layers are saved in the background, at most one save is in
+ *        flight, so it overlaps with computing the next layer.
+ *        All files of a run are <dir>/<name>.*, several runs (e.g. both
+ *        directions of a bidirectional one) can share a directory.
+ */
+class Checkpoint {
+ public:
+
+    using write_fn = std::function<void(const int fd)>;
+
+    /// @param dir - disabled if empty, created if missing
+    /// @param key - identifies the instance and the layout of its layers,
+    ///              manifests of any other key are ignored
+    Checkpoint(const std::string &dir, const std::string &name,
+               const std::string &key)
+        : dir(dir), name(name), key(key)
+    {
+        if (dir.empty()) return;
+        std::error_code err_code;
+        std::filesystem::create_directories(dir, err_code);
+        if (err_code) {
+            throw std::runtime_error("Failed to create checkpoint dir "
+                                   + dir + ": " + err_code.message());
+        }
+    }
+
+    ~Checkpoint() {
+        if (this->pending.valid()) this->pending.wait();
+    }
+
+    Checkpoint(const Checkpoint &) = delete;
+    Checkpoint& operator=(const Checkpoint &) = delete;
+
+    [[ nodiscard ]] bool isEnabled() const noexcept {
+        return !this->dir.empty();
+    }
+
+    /**
+     * @return cardinality of the last complete layer saved by a run of
+     *         the same key, 0 if there is none; states pruned against a
+     *         bound below the given one may be needed, so then also 0
+     */
+    [[ nodiscard ]] int findResumable(const double bound) const {
+        if (!this->isEnabled()) return 0;
+        std::ifstream manifest(this->file("manifest"));
+        std::string field;
+        std::string saved_key;
+        double saved_bound = 0.;
+        int cardinality = 0;
+        if (!(manifest >> field) || field != "key") return 0;
+        manifest.ignore(1);  // single space before key
+        if (!std::getline(manifest, saved_key)) return 0;
+        if (!(manifest >> field >> saved_bound) || field != "bound") return 0;
+        if (!(manifest >> field >> cardinality) || field != "cardinality") {
+            return 0;
+        }
+        if (saved_key != this->key || saved_bound < bound) return 0;
+        return cardinality;
+    }
+
+    /// @brief Costs of the layer of given cardinality are read by read(fd).
+    void loadCosts(const int cardinality, const write_fn &read) const {
+        this->load(costsSuffix(cardinality), read);
+    }
+
+    /// @brief Previous vertices stored while extending sets of given
+    ///        cardinality are read by read(fd).
+    void loadPrevs(const int cardinality, const write_fn &read) const {
+        this->load(prevsSuffix(cardinality), read);
+    }
+
+    /**
+     * @brief Waits for the previous save, then in the background writes
+     *        costs of the layer of given cardinality and previous vertices
+     *        stored while extending the one before it (if write_prevs),
+     *        then the manifest naming the layer as complete, and removes
+     *        the previous layer's costs unless keep_prev_costs. Data
+     *        written must not change until the next call of save or wait.
+     */
+    void save(const int cardinality, const double bound,
+              write_fn write_costs, write_fn write_prevs = nullptr,
+              const bool keep_prev_costs = false) {
+        this->wait();
+        this->pending = std::async(std::launch::async, [=, this] () {
+            writeFile(this->file(costsSuffix(cardinality)), write_costs);
+            if (write_prevs) {
+                writeFile(this->file(prevsSuffix(cardinality - 1)),
+                          write_prevs);
+            }
+            std::ostringstream manifest;
+            manifest.precision(std::numeric_limits<double>::max_digits10);
+            manifest << "key " << this->key << "\n"
+                     << "bound " << bound << "\n"
+                     << "cardinality " << cardinality << "\n";
+            const std::string text = manifest.str();
+            writeFile(this->file("manifest"), [&] (const int fd) {
+                writeAll(fd, text.data(), text.size());
+            });
+            if (keep_prev_costs) return;
+            std::error_code err_code;  // best effort, only takes space
+            std::filesystem::remove(
+                this->file(costsSuffix(cardinality - 1)), err_code
+            );
+        });
+    }
+
+    /// @brief Waits for the save in flight, rethrows its failure.
+    void wait() {
+        if (this->pending.valid()) this->pending.get();
+    }
+
+    /// @brief Removes all files of the run, e.g. once it is finished.
+    void clear() {
+        if (!this->isEnabled()) return;
+        this->wait();
+        std::error_code err_code;
+        const std::string prefix = this->name + ".";
+        for (const auto &entry
+             : std::filesystem::directory_iterator(this->dir, err_code)
+        ) {
+            const std::string file_name = entry.path().filename().string();
+            if (file_name.compare(0, prefix.size(), prefix) == 0) {
+                std::filesystem::remove(entry.path(), err_code);
+            }
+        }
+    }
+
+    static void writeAll(const int fd, const void * const data,
+                         const size_t num_bytes) {
+        const char *bytes = static_cast<const char *>(data);
+        for (size_t done = 0; done < num_bytes; ) {
+            const ssize_t written = ::write(fd, bytes + done, num_bytes - done);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throwErrno("Failed to write checkpoint");
+            }
+            done += static_cast<size_t>(written);
+        }
+    }
+
+    static void readAll(const int fd, void * const data,
+                        const size_t num_bytes) {
+        char *bytes = static_cast<char *>(data);
+        for (size_t done = 0; done < num_bytes; ) {
+            const ssize_t num_read = ::read(fd, bytes + done, num_bytes - done);
+            if (num_read < 0 && errno == EINTR) continue;
+            if (num_read <= 0) throwErrno("Failed to read checkpoint");
+            done += static_cast<size_t>(num_read);
+        }
+    }
+
+ private:
+
+    std::string dir;
+    std::string name;
+    std::string key;
+    std::future<void> pending;
+
+    static std::string costsSuffix(const int cardinality) {
+        return "costs_" + std::to_string(cardinality);
+    }
+
+    static std::string prevsSuffix(const int cardinality) {
+        return "prevs_" + std::to_string(cardinality);
+    }
+
+    [[ nodiscard ]] std::string file(const std::string &suffix) const {
+        return this->dir + "/" + this->name + "." + suffix;
+    }
+
+    void load(const std::string &suffix, const write_fn &read) const {
+        const std::string path = this->file(suffix);
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throwErrno("Failed to open checkpoint " + path);
+        try {
+            read(fd);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+
+    [[ noreturn ]] static void throwErrno(const std::string &msg) {
+        throw std::runtime_error(msg + ": " + std::strerror(errno));
+    }
+
+    static void writeFile(const std::string &path, const write_fn &write) {
+        const std::string tmp_path = path + ".tmp";
+        const int fd = ::open(tmp_path.c_str(),
+                              O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throwErrno("Failed to create checkpoint " + tmp_path);
+        try {
+            write(fd);
+            if (::fsync(fd) != 0) throwErrno("Failed to sync " + tmp_path);
+        } catch (...) {
+            ::close(fd);
+            ::unlink(tmp_path.c_str());
+            throw;
+        }
+        ::close(fd);
+        if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            throwErrno("Failed to rename checkpoint " + tmp_path);
+        }
+    }
+
+};
+
+}  // detail namesspace
+
+#endif
@@ -6,10 +6,13 @@
 #include <iomanip>
 #include <iostream>
 #include "bellman_held_karp.hpp"
+#include "half_float.hpp"
 #include "../common/random.hpp"
 
 namespace detail {
 
+/// half floats are storage types of layers, computed in float, see
+/// detail::compute_t
 using cost_t_variant = std::variant<
     uint8_t,
     uint16_t,
@@ -20,9 +23,68 @@ using cost_t_variant = std::variant<
     int32_t,
     int64_t,
     float,
-    double
+    double,
+    float16,
+    bfloat16
 >;
 
+/**
+ * @brief Reverses segments of the path while that makes it cheaper,
+ *        costs of reversed edges are summed as they are, so asymmetric
+ *        weights are fine too. Endpoints of a path are not connected.
+ */
+template<typename T>
+void improveBy2Opt(
+    std::vector<int> &path,
+    const std::vector<std::vector<T>> &weights,
+    const bool search_for_cycle
+) {
+    const int n = path.size();
+    if (n < 2) return;
+    // [k] sums costs of the first k edges, forwards and backwards
+    std::vector<double> forward(n), backward(n);
+    const auto edge = [&] (const int from_idx, const int to_idx) {
+        if (from_idx < 0 || to_idx >= n) {  // past an endpoint of the path
+            if (!search_for_cycle) return 0.;
+        }
+        return static_cast<double>(
+            weights[path[(from_idx + n) % n]][path[to_idx % n]]
+        );
+    };
+    for (bool is_improved = true; is_improved; ) {
+        is_improved = false;
+        for (int k = 1; k < n; ++k) {
+            forward[k] = forward[k - 1] + edge(k - 1, k);
+            backward[k] = backward[k - 1] + edge(k, k - 1);
+        }
+        const double min_gain = 1e-12 * (1. + std::abs(forward[n - 1]));
+        for (int first = 0; first < n - 1 && !is_improved; ++first) {
+            for (int last = first + 1; last < n; ++last) {
+                // whole cycle reversed is the same cycle
+                if (search_for_cycle && first == 0 && last == n - 1) break;
+                const double cur = edge(first - 1, first)
+                                 + forward[last] - forward[first]
+                                 + edge(last, last + 1);
+                const double reversed = edge(first - 1, last)
+                                      + backward[last] - backward[first]
+                                      + edge(first, last + 1);
+                if (reversed < cur - min_gain) {
+                    std::reverse(path.begin() + first,
+                                 path.begin() + last + 1);
+                    is_improved = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Cost of a nearest neighbour tour polished by 2-opt, the best
+ *        one out of vertex 0 and num_samples random starting vertices,
+ *        usually within a few percent of the optimum, so that the cost
+ *        type and scaling do not reserve range for costs never reached.
+ */
 template<typename T>
 T estimateMaxPossibleCost(
     const std::vector<std::vector<T>>& weights,
@@ -44,10 +106,32 @@ T estimateMaxPossibleCost(
         return cur_cost;
     };
 
+    std::vector<bool> is_visited(n);
+    const auto build_nearest_neighbour = [&] (const int start) {
+        std::fill(is_visited.begin(), is_visited.end(), false);
+        path[0] = start;
+        is_visited[start] = true;
+        for (int i = 1; i < n; ++i) {
+            int nearest = -1;
+            for (int v = 0; v < n; ++v) {
+                if (is_visited[v]) continue;
+                if ( nearest < 0
+                  || weights[path[i - 1]][v] < weights[path[i - 1]][nearest]
+                ) {
+                    nearest = v;
+                }
+            }
+            path[i] = nearest;
+            is_visited[nearest] = true;
+        }
+        improveBy2Opt(path, weights, search_for_cycle);
+    };
+
     T best_cost_upper_bound = calc_cost();
     std::vector<int> best_path = path;
-    for ( ; num_samples > 0; --num_samples) {
-        random::permuteRandomly(path, psrng);
+    for (int sample = 0; sample <= num_samples && n > 0; ++sample) {
+        const int start = sample == 0 ? 0 : psrng() % n;
+        build_nearest_neighbour(start);
         T cost = calc_cost();
         if (cost < best_cost_upper_bound) {
             best_cost_upper_bound = cost;
@@ -79,7 +163,8 @@ detail::cost_t_variant chooseCostType(
     const bool is_symmetric,
     const bool cost_only,
     const int verbose = 1,
-    const bool forbid_unsigned = false
+    const bool forbid_unsigned = false,
+    const bool bidirectional = false
 ) {
     // needed bits to fit precision * max_cost into an integer
     int needed_bits_cost_t_precision = max_possible_cost <= 1e-12 ?
@@ -96,7 +181,8 @@ detail::cost_t_variant chooseCostType(
 
     // maxB = 1B * path + xB * costs => x = (max - 1B * path) / costs
     const auto space = calcSpaceNeeded(num_points, search_cycle,
-                                       is_symmetric, cost_only);
+                                       is_symmetric, cost_only,
+                                       bidirectional);
     if (verbose > 0) {
         std::cout << "Memory needed for path: " << space.first << " locs, for costs: "
                   << space.second << " locs." << std::endl;
@@ -150,6 +236,22 @@ detail::cost_t_variant chooseCostType(
             }
             return float{};
         }
+        else if (max_num_bits_cost_t >= 16 && do_not_prefer_int) {
+            // stored in 16 bits and computed in float, an integer of the
+            // same width has more digits, so only if floats are preferred;
+            // bfloat16 keeps the range of float if its digits suffice,
+            // else float16 has more of them within a scaled range
+            if (needed_bits_cost_t_precision <= detail::bfloat16::digits) {
+                if (verbose > 0) {
+                    std::cout << "Selected cost_t = bfloat16" << std::endl;
+                }
+                return detail::bfloat16{};
+            }
+            if (verbose > 0) {
+                std::cout << "Selected cost_t = float16" << std::endl;
+            }
+            return detail::float16{};
+        }
 
         // use integer that there is enough memory for
         if (verbose > 0) {
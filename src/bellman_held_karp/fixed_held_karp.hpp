@@ -0,0 +1,287 @@
+#ifndef FIXED_HELD_KARP_HPP
+#define FIXED_HELD_KARP_HPP
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include "min_plus_kernels.hpp"
+#include "layer_observer.hpp"
+
+namespace detail {
+namespace fixed {
+
+constexpr int min_n = 4;
+constexpr int max_n = 20;
+// above it merging symmetric halves beats solving all layers
+constexpr int max_symmetric_n = 10;
+
+/// @brief binom[n][k] = C(n, k) for n, k <= N + 1, 0 for k > n.
+template<int N>
+constexpr auto makeBinomials() {
+    std::array<std::array<uint32_t, N + 2>, N + 2> binom {};
+    for (int n = 0; n <= N + 1; ++n) {
+        binom[n][0] = 1U;
+        for (int k = 1; k <= n; ++k) {
+            binom[n][k] = binom[n - 1][k - 1] + binom[n - 1][k];
+        }
+    }
+    return binom;
+}
+
+/// @brief layer_starts[k] = num of (set, end) states of sets below k.
+template<int N>
+constexpr auto makeLayerStarts() {
+    constexpr auto binom = makeBinomials<N>();
+    std::array<uint32_t, N + 2> starts {};
+    for (int k = 1; k <= N; ++k) {
+        starts[k + 1] = starts[k] + binom[N][k] * k;
+    }
+    return starts;
+}
+
+/// @return max num of (set, end) states within a single layer
+template<int N>
+constexpr uint32_t maxLayerSize() {
+    constexpr auto binom = makeBinomials<N>();
+    uint32_t max_size = 0U;
+    for (int k = 1; k <= N; ++k) {
+        max_size = std::max(max_size, binom[N][k] * k);
+    }
+    return max_size;
+}
+
+/// num of T's in a weights row, N padded to a cache line
+template<typename T, int N>
+constexpr int row_stride_v = (N + min_plus::row_align_v<T> - 1)
+                           / min_plus::row_align_v<T>
+                           * min_plus::row_align_v<T>;
+
+/// @brief Layers and previous vertices of the N vertex DP, their sizes
+///        are known at compile time, so these are plain arrays.
+template<typename T, typename vertex_t, int N, bool find_path>
+struct Tables {
+    alignas(64) std::array<T, N * row_stride_v<T, N>> weights;  // [src][dst]
+    std::array<T, N> from_start;
+    std::array<T, N> to_start;
+    std::array<T, maxLayerSize<N>()> costs_prev;  // [rank * card + end idx]
+    std::array<T, maxLayerSize<N>()> costs_next;
+    std::array<vertex_t, find_path ? makeLayerStarts<N>()[N + 1] : 1> prevs;
+};
+
+/**
+ * @brief Bellman-Held-Karp over exactly N vertices (and the starting
+ *        point if end_in_starting_point), sets fit in uint32_t, binomials
+ *        and layer offsets are constexpr and every loop bound is known
+ *        at compile time. Small tables are on the stack, bigger ones
+ *        are allocated once per thread and reused.
+ *        No pruning nor merging of symmetric halves, every layer is
+ *        extended up to N vertices.
+ * @return min cost, if not below best_cost then best_cost and
+ *         solution is cleared, same as bellmanHeldKarp
+ */
+template<typename T, typename vertex_t, int N, bool find_path>
+[[ gnu::hot ]]
+T bellmanHeldKarp(
+    std::vector<vertex_t> &solution,
+    const std::vector<std::vector<T>> &weights,
+    const bool end_in_starting_point,
+    const T best_cost
+) {
+    using set_t = uint32_t;
+    using tables_t = Tables<T, vertex_t, N, find_path>;
+    using lane_idx_t = min_plus::lane_idx_t<T>;
+    static constexpr auto binom = makeBinomials<N>();
+    static constexpr auto layer_starts = makeLayerStarts<N>();
+    static_assert(N <= 32 && N <= std::numeric_limits<vertex_t>::max());
+
+    constexpr bool is_on_stack = sizeof(tables_t) <= (1U << 16);
+    struct NoTables {};
+    [[ maybe_unused ]] std::conditional_t<is_on_stack, tables_t, NoTables>
+        stack_tables;
+    tables_t *tables;
+    if constexpr (is_on_stack) {
+        tables = &stack_tables;
+    } else {
+        static thread_local const std::unique_ptr<tables_t> heap_tables
+            = std::make_unique_for_overwrite<tables_t>();
+        tables = heap_tables.get();
+    }
+    constexpr int stride = row_stride_v<T, N>;
+    static const auto relax_dsts = min_plus::selectRelaxDsts<T>();
+    T * __restrict const w = tables->weights.data();
+    for (int src = 0; src < N; ++src) {
+        for (int dst = 0; dst < stride; ++dst) {
+            w[src * stride + dst] = dst < N ? weights[src][dst] : (T) 0;
+        }
+        // a path has no starting point, nothing enters nor leaves it
+        tables->from_start[src] = end_in_starting_point ? weights[N][src]
+                                                        : (T) 0;
+        tables->to_start[src] = end_in_starting_point ? weights[src][N]
+                                                      : (T) 0;
+    }
+
+    T *costs_prev = tables->costs_prev.data();
+    T *costs_next = tables->costs_next.data();
+    std::copy_n(tables->from_start.data(), N, costs_prev);
+
+    for (int card = 1; card < N; ++card) {
+        const LayerTimer layer_timer;
+        vertex_t * const layer_prevs = tables->prevs.data()
+                                     + (find_path ? layer_starts[card + 1] : 0);
+        const T * cost_prev = costs_prev;
+        set_t set = (static_cast<set_t>(1) << card) - 1U;
+        for (uint32_t set_idx = binom[N][card];
+             set_idx;
+             --set_idx, cost_prev += card
+        ) {
+            // rank(set + dst) = suffix[0] - suffix[i] + C(dst, i + 1)
+            //                 + shifted[i], i = num of vertices below dst
+            uint8_t srcs[N];
+            uint32_t suffix[N + 1];
+            uint32_t shifted[N + 1];
+            int num_srcs = 0;
+            for (set_t bits = set; bits; bits &= bits - 1U) {
+                srcs[num_srcs++] = (uint8_t) __builtin_ctz(bits);
+            }
+            suffix[card] = shifted[card] = 0U;
+            for (int i = card - 1; i >= 0; --i) {
+                suffix[i] = suffix[i + 1] + binom[srcs[i]][i + 1];
+                shifted[i] = shifted[i + 1] + binom[srcs[i]][i + 2];
+            }
+
+            // all dsts are relaxed at once over full rows, set's own are
+            // unused, without a kernel for T the loops are branchless over
+            // compile-time bounds so they vectorize
+            alignas(64) T best[stride];
+            alignas(64) lane_idx_t best_src[stride];
+            if (relax_dsts != nullptr) {
+                relax_dsts(cost_prev, srcs, card, w, stride, N,
+                           best, best_src);
+            } else {
+                for (int dst = 0; dst < stride; ++dst) {
+                    best[dst] = cost_prev[0] + w[srcs[0] * stride + dst];
+                    best_src[dst] = srcs[0];
+                }
+                for (int i = 1; i < card; ++i) {
+                    const T cost = cost_prev[i];
+                    const lane_idx_t src = srcs[i];
+                    const T * __restrict const row = w + src * stride;
+                    for (int dst = 0; dst < stride; ++dst) {
+                        const T sum = cost + row[dst];
+                        const bool is_lt = sum < best[dst];
+                        best[dst] = is_lt ? sum : best[dst];
+                        if constexpr (find_path) {
+                            best_src[dst] = is_lt ? src : best_src[dst];
+                        }
+                    }
+                }
+            }
+
+            int next_dst_rank = 0;
+            for (int dst = 0; dst < N; ++dst) {
+                if ((set >> dst) & 1U) {
+                    ++next_dst_rank;
+                    continue;
+                }
+                const uint32_t rank = suffix[0] - suffix[next_dst_rank]
+                                    + binom[dst][next_dst_rank + 1]
+                                    + shifted[next_dst_rank];
+                const uint32_t entry = rank * (card + 1) + next_dst_rank;
+                costs_next[entry] = best[dst];
+                if constexpr (find_path) {
+                    layer_prevs[entry] = (vertex_t) best_src[dst];
+                }
+            }
+
+            // Gosper's hack:
+            const set_t c = set & -set;
+            const set_t r = set + c;
+            set = (((r ^ set) >> 2) / c) | r;
+        }
+        std::swap(costs_prev, costs_next);
+        layer_timer.done(card, binom[N][card]);
+    }
+
+    // all vertices visited, costs_prev[end] for the only set of N vertices
+    T cost = std::numeric_limits<T>::max();
+    int last = 0;
+    for (int end = 0; end < N; ++end) {
+        const T closing = costs_prev[end] + tables->to_start[end];
+        if (closing < cost) {
+            cost = closing;
+            last = end;
+        }
+    }
+    if (!(cost < best_cost)) {
+        solution.clear();
+        return best_cost;
+    }
+    if constexpr (!find_path) return cost;
+
+    solution.resize(end_in_starting_point ? N + 2 : N);
+    vertex_t * const path = solution.data() + end_in_starting_point;
+    set_t set = static_cast<set_t>((1ULL << N) - 1ULL);
+    for (int card = N; card >= 2; --card) {
+        path[card - 1] = (vertex_t) last;
+        uint32_t rank = 0U;
+        int i = 0;
+        for (set_t bits = set; bits && card < N; bits &= bits - 1U) {
+            rank += binom[__builtin_ctz(bits)][++i];
+        }
+        const int end_idx = __builtin_popcount(set & ((1U << last) - 1U));
+        set ^= static_cast<set_t>(1) << last;
+        last = tables->prevs[layer_starts[card] + rank * card + end_idx];
+    }
+    path[0] = (vertex_t) last;
+    if (end_in_starting_point) {
+        solution.front() = solution.back() = (vertex_t) N;
+    }
+    return cost;
+}
+
+template<typename T, typename vertex_t>
+using solver_t = T (*)(
+    std::vector<vertex_t> &,
+    const std::vector<std::vector<T>> &,
+    const bool,
+    const T
+);
+
+template<typename T, typename vertex_t, bool find_path, int N>
+constexpr solver_t<T, vertex_t> specializedFor() {
+    if constexpr (N < min_n) return nullptr;
+    else return &bellmanHeldKarp<T, vertex_t, N, find_path>;
+}
+
+template<typename T, typename vertex_t, bool find_path, int... Ns>
+constexpr auto makeDispatchTable(std::integer_sequence<int, Ns...>) {
+    return std::array<solver_t<T, vertex_t>, max_n + 1> {
+        specializedFor<T, vertex_t, find_path, Ns>()...
+    };
+}
+
+/// @return solver specialized for n vertices, nullptr if there is none
+template<typename T, typename vertex_t>
+solver_t<T, vertex_t> selectSolver(const int n, const bool find_path) {
+    if (n < min_n || n > max_n) return nullptr;
+    if (find_path) {
+        static constexpr auto table = makeDispatchTable<T, vertex_t, true>(
+            std::make_integer_sequence<int, max_n + 1>()
+        );
+        return table[n];
+    }
+    static constexpr auto table = makeDispatchTable<T, vertex_t, false>(
+        std::make_integer_sequence<int, max_n + 1>()
+    );
+    return table[n];
+}
+
+}  // fixed namespace
+}  // detail namesspace
+
+#endif
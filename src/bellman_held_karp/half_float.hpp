@@ -0,0 +1,90 @@
+#ifndef HALF_FLOAT_HPP
+#define HALF_FLOAT_HPP
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace detail {
+
+/**
+ * @brief Storage only floating point costs of 2 B, layers keep them and
+ *        all sums are computed in float. Infinity, also any float that
+ *        overflows the type, reads back as max of float, i.e. as dead.
+ */
+
+/// @brief IEEE binary16, 11 significant bits, finite up to 65504, so
+///        weights are scaled into its range.
+struct float16 {
+    static constexpr int digits = 11;
+    static constexpr double epsilon = 1. / (1 << (digits - 1));
+    static constexpr const char *name = "float16";
+
+    _Float16 value;
+
+    float16() = default;
+    explicit float16(const float x) noexcept
+        : value(static_cast<_Float16>(x)) {}
+
+    [[ gnu::always_inline ]] operator float() const noexcept {
+        const float x = static_cast<float>(this->value);
+        return x == std::numeric_limits<float>::infinity()
+             ? std::numeric_limits<float>::max() : x;
+    }
+};
+
+/// @brief Upper half of a float, 8 significant bits but the whole range
+///        of float, rounded to nearest even.
+struct bfloat16 {
+    static constexpr int digits = 8;
+    static constexpr double epsilon = 1. / (1 << (digits - 1));
+    static constexpr const char *name = "bfloat16";
+
+    uint16_t bits;
+
+    bfloat16() = default;
+    explicit bfloat16(const float x) noexcept {
+        const uint32_t x_bits = std::bit_cast<uint32_t>(x);
+        // overflows into infinity, costs are never NaN
+        this->bits = static_cast<uint16_t>(
+            (x_bits + 0x7fffU + ((x_bits >> 16) & 1U)) >> 16
+        );
+    }
+
+    [[ gnu::always_inline ]] operator float() const noexcept {
+        constexpr uint16_t inf_bits = 0x7f80U;
+        return this->bits == inf_bits
+             ? std::numeric_limits<float>::max()
+             : std::bit_cast<float>(static_cast<uint32_t>(this->bits) << 16);
+    }
+};
+
+template<typename T>
+constexpr bool is_half_float_v = std::is_same_v<T, float16>
+                              || std::is_same_v<T, bfloat16>;
+
+/// type costs stored as T are computed in
+template<typename T>
+using compute_t = std::conditional_t<is_half_float_v<T>, float, T>;
+
+/// @return relative rounding error of a cost stored as T, 0 for integers
+template<typename T>
+constexpr double storageEpsilon() {
+    if constexpr (is_half_float_v<T>) return T::epsilon;
+    else if constexpr (std::is_floating_point_v<T>) {
+        return std::numeric_limits<T>::epsilon();
+    }
+    else return 0.;
+}
+
+/// @return name of a half float T, empty for other types
+template<typename T>
+constexpr const char * storageName() {
+    if constexpr (is_half_float_v<T>) return T::name;
+    else return "";
+}
+
+}  // detail namesspace
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef LAYER_OBSERVER_HPP
+#define LAYER_OBSERVER_HPP
+
+#include <chrono>
+#include <functional>
+#include <utility>
+
+namespace detail {
+
+/// @brief All sets of a cardinality extended by each vertex outside them,
+///        the last layer of merged halves also joins them with the others.
+struct LayerStats {
+    int cardinality;  // of the extended sets
+    unsigned long long num_sets;  // extended, pruned ones included
+    double seconds;
+};
+
+/// @brief If set, solvers report each extended layer to it, e.g. for
+///        benchmarks. Thread local, so concurrent solves on other threads
+///        are not reported, unset by default and then a layer costs a
+///        single check.
+inline thread_local std::function<void(const LayerStats &)> on_layer_done;
+
+/// @brief Measures a layer from construction to done(), only if there is
+///        anyone to report it to.
+class LayerTimer {
+ public:
+
+    LayerTimer() : is_observed(static_cast<bool>(on_layer_done)) {
+        if (this->is_observed) this->start = std::chrono::steady_clock::now();
+    }
+
+    void done(const int cardinality, const unsigned long long num_sets) const {
+        if (!this->is_observed) return;
+        const std::chrono::duration<double> elapsed
+            = std::chrono::steady_clock::now() - this->start;
+        on_layer_done({ cardinality, num_sets, elapsed.count() });
+    }
+
+ private:
+
+    const bool is_observed;
+    std::chrono::steady_clock::time_point start;
+};
+
+/// @brief Layers of nested solves, e.g. of recomputed halves, are not
+///        reported while it lives.
+class LayerObserverPause {
+ public:
+
+    LayerObserverPause() : paused(std::exchange(on_layer_done, nullptr)) {}
+
+    ~LayerObserverPause() { on_layer_done = std::move(this->paused); }
+
+    LayerObserverPause(const LayerObserverPause &) = delete;
+    LayerObserverPause& operator=(const LayerObserverPause &) = delete;
+
+ private:
+
+    std::function<void(const LayerStats &)> paused;
+};
+
+}  // detail namesspace
+
+#endif
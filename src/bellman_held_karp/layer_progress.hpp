@@ -0,0 +1,148 @@
+#ifndef LAYER_PROGRESS_HPP
+#define LAYER_PROGRESS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "layer_observer.hpp"
+#include "subset_rank.hpp"
+
+namespace detail {
+
+/**
+ * @brief While it lives, each layer a solver finishes on this thread is
+ *        written to a file or pipe as a JSON line, flushed at once:
+ *        { "cardinality", "num_sets", "relaxations", "seconds",
+ *          "relaxations_per_s", "rss_kb", "minor_faults", "major_faults",
+ *          "elapsed_s", "eta_s" }
+ *        Faults are those of the layer, the ETA extrapolates the rate so
+ *        far over the remaining layers by their num_sets * card * (n - card)
+ *        relaxations. Built on detail::on_layer_done, so solvers are not
+ *        touched, and replaces any observer set before until destroyed.
+ */
+class LayerProgressLog {
+ public:
+
+    /// @param n - vertices of the solver, without the start of a cycle
+    /// @param is_merged - halves up to n / 2 are merged
+    /// @param is_bidirectional - a backward run precedes the forward one
+    LayerProgressLog(
+        const std::string &path,
+        const int n,
+        const bool is_merged,
+        const bool is_bidirectional
+    ) : out(path), n(n), start(std::chrono::steady_clock::now()),
+        prev_faults(readFaults())
+    {
+        if (!this->out.is_open()) {
+            throw std::runtime_error(
+                "Could not open progress log: " + path
+            );
+        }
+        const int max_card = is_merged ? std::max(1, n / 2) : n - 1;
+        const Binomials bin_coef(n, n);
+        const auto add_layers = [&] (const int last_card) {
+            for (int card = 1; card <= last_card; ++card) {
+                this->expected_cards.push_back(card);
+                this->remaining_work.push_back(
+                    1. * bin_coef(n, card) * card * (n - card)
+                );
+            }
+        };
+        if (is_bidirectional) add_layers(max_card - 1);
+        add_layers(max_card);
+        // [i] becomes the work of layers i and after them
+        this->remaining_work.push_back(0.);
+        for (int i = static_cast<int>(this->remaining_work.size()) - 2;
+             i >= 0;
+             --i
+        ) {
+            this->remaining_work[i] += this->remaining_work[i + 1];
+        }
+        this->replaced = std::exchange(
+            on_layer_done,
+            [this] (const LayerStats &stats) { this->write(stats); }
+        );
+    }
+
+    ~LayerProgressLog() { on_layer_done = std::move(this->replaced); }
+
+    LayerProgressLog(const LayerProgressLog &) = delete;
+    LayerProgressLog& operator=(const LayerProgressLog &) = delete;
+
+ private:
+
+    std::ofstream out;
+    const int n;
+    const std::chrono::steady_clock::time_point start;
+    std::pair<long, long> prev_faults;  // (minor, major)
+    std::vector<int> expected_cards;
+    std::vector<double> remaining_work;
+    size_t next_layer = 0;  // in expected_cards
+    double done_relaxations = 0.;
+    double done_seconds = 0.;
+    std::function<void(const LayerStats &)> replaced;
+
+    static std::pair<long, long> readFaults() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return { usage.ru_minflt, usage.ru_majflt };
+    }
+
+    /// @return resident set size [kB], -1 without procfs
+    static long readRss() {
+        std::ifstream statm("/proc/self/statm");
+        long num_pages = -1L, num_resident = -1L;
+        if (!(statm >> num_pages >> num_resident)) return -1L;
+        return num_resident * (sysconf(_SC_PAGESIZE) / 1024L);
+    }
+
+    void write(const LayerStats &stats) {
+        const double relaxations = 1. * stats.num_sets * stats.cardinality
+                                 * (this->n - stats.cardinality);
+        this->done_relaxations += relaxations;
+        this->done_seconds += stats.seconds;
+        // resumed or skipped layers are never reported
+        while ( this->next_layer < this->expected_cards.size()
+             && this->expected_cards[this->next_layer] != stats.cardinality
+        ) {
+            ++this->next_layer;
+        }
+        if (this->next_layer < this->expected_cards.size()) {
+            ++this->next_layer;
+        }
+        const double rate = this->done_seconds > 0.
+                          ? this->done_relaxations / this->done_seconds : 0.;
+        const double eta = rate > 0.
+                         ? this->remaining_work[this->next_layer] / rate : 0.;
+        const std::pair<long, long> faults = readFaults();
+        const std::chrono::duration<double> elapsed
+            = std::chrono::steady_clock::now() - this->start;
+        this->out << "{\"cardinality\": " << stats.cardinality
+                  << ", \"num_sets\": " << stats.num_sets
+                  << ", \"relaxations\": "
+                  << static_cast<unsigned long long>(relaxations)
+                  << ", \"seconds\": " << stats.seconds
+                  << ", \"relaxations_per_s\": "
+                  << (stats.seconds > 0. ? relaxations / stats.seconds : 0.)
+                  << ", \"rss_kb\": " << readRss()
+                  << ", \"minor_faults\": "
+                  << faults.first - this->prev_faults.first
+                  << ", \"major_faults\": "
+                  << faults.second - this->prev_faults.second
+                  << ", \"elapsed_s\": " << elapsed.count()
+                  << ", \"eta_s\": " << eta << "}" << std::endl;
+        this->prev_faults = faults;
+    }
+};
+
+}  // detail namesspace
+
+#endif
@@ -0,0 +1,394 @@
+#ifndef LAYER_STORAGE_HPP
+#define LAYER_STORAGE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "half_float.hpp"
+
+namespace detail {
+
+/**
+ * @brief Contiguous array of DP layer entries, either in anonymous memory
+ *        or out-of-core in a memory-mapped file so layers larger than RAM
+ *        are paged in and out by the OS.
+ *        File is unlinked right after creation, so it is removed on exit.
+ *        In memory, arrays of at least a huge page are mapped on explicit
+ *        huge pages if reserved, else aligned for transparent ones, are
+ *        interleaved over NUMA nodes and never zero-filled by the process.
+ */
+template<typename T>
+class LayerBuffer {
+ public:
+
+    LayerBuffer() = default;
+
+    ~LayerBuffer() { this->unmap(); }
+
+    LayerBuffer(const LayerBuffer &) = delete;
+    LayerBuffer& operator=(const LayerBuffer &) = delete;
+
+    /// @param backing_dir - directory for the mapped file, memory if empty
+    void allocate(const size_t num_elements, const std::string &backing_dir) {
+        this->unmap();
+        this->heap.clear();
+        this->num_elements = num_elements;
+        if (backing_dir.empty()) {
+            if (num_elements * sizeof(T) >= huge_page_bytes) {
+                this->mapAnonymous(num_elements * sizeof(T));
+            } else {
+                this->heap.resize(num_elements);
+                this->ptr = this->heap.data();
+            }
+            return;
+        }
+        if (num_elements == 0) return;
+
+        std::string path = backing_dir + "/bhk_layer_XXXXXX";
+        const int fd = ::mkstemp(path.data());
+        if (fd < 0) throwErrno("Failed to create layer file in " + backing_dir);
+        ::unlink(path.c_str());
+        this->num_bytes = num_elements * sizeof(T);
+        if (::ftruncate(fd, static_cast<off_t>(this->num_bytes)) != 0) {
+            ::close(fd);
+            throwErrno("Failed to resize layer file in " + backing_dir);
+        }
+        void * const mapped = ::mmap(nullptr, this->num_bytes,
+                                     PROT_READ | PROT_WRITE, MAP_SHARED,
+                                     fd, 0);
+        ::close(fd);  // mapping keeps the file alive
+        if (mapped == MAP_FAILED) {
+            this->num_bytes = 0;
+            throwErrno("Failed to map layer file in " + backing_dir);
+        }
+        this->ptr = static_cast<T *>(mapped);
+        this->is_file_backed = true;
+    }
+
+    /// @brief Frees all memory, or the file, of the buffer.
+    void release() {
+        this->unmap();
+        std::vector<T>().swap(this->heap);
+        this->num_elements = 0;
+    }
+
+    [[ nodiscard ]] bool isFileBacked() const noexcept {
+        return this->is_file_backed;
+    }
+    [[ nodiscard ]] size_t size() const noexcept { return this->num_elements; }
+    [[ nodiscard ]] T * data() noexcept { return this->ptr; }
+    [[ nodiscard ]] const T * data() const noexcept { return this->ptr; }
+    T & operator[](const size_t idx) noexcept { return this->ptr[idx]; }
+    const T & operator[](const size_t idx) const noexcept {
+        return this->ptr[idx];
+    }
+
+    /**
+     * @brief Faults in anonymous memory from all of pool's workers,
+     *        in huge page aligned chunks so no page is touched twice,
+     *        instead of page faults serializing the first layers.
+     */
+    template<typename pool_t>
+    void firstTouch(pool_t &pool) {
+        if (this->num_bytes == 0 || this->is_file_backed) return;
+        const size_t num_chunks = (this->num_bytes + huge_page_bytes - 1)
+                                / huge_page_bytes;
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        char * const bytes = reinterpret_cast<char *>(this->ptr);
+        pool.parallelFor(num_chunks, [&] (const unsigned long long chunk, int) {
+            const size_t begin = static_cast<size_t>(chunk) * huge_page_bytes;
+            const size_t end = std::min(this->num_bytes,
+                                        begin + huge_page_bytes);
+            for (size_t i = begin; i < end; i += page) {
+                bytes[i] = 0;
+            }
+        });
+    }
+
+    /// @brief Hint that [begin, end) is about to be read front to back.
+    void adviseSequential(const size_t begin, const size_t end) const {
+        this->advise(begin, end, MADV_SEQUENTIAL);
+    }
+
+    /// @brief Starts writeback of [begin, end) and drops it from the
+    ///        resident set, contents are kept in the file.
+    void evict(const size_t begin, const size_t end) const {
+        void *page_begin;
+        size_t len;
+        if (!this->pagesWithin(begin, end, page_begin, len)) return;
+        ::msync(page_begin, len, MS_ASYNC);
+        ::madvise(page_begin, len, MADV_DONTNEED);
+    }
+
+    /// @brief Contents of [begin, end) will not be read before rewritten,
+    ///        frees its pages both in memory and on disk.
+    void discard(const size_t begin, const size_t end) const {
+        void *page_begin;
+        size_t len;
+        if (!this->pagesWithin(begin, end, page_begin, len)) return;
+        if (::madvise(page_begin, len, MADV_REMOVE) != 0) {
+            // filesystem cannot punch holes
+            ::madvise(page_begin, len, MADV_DONTNEED);
+        }
+    }
+
+ private:
+
+    static constexpr size_t huge_page_bytes = 1ULL << 21;
+
+    std::vector<T> heap;
+    T *ptr = nullptr;
+    size_t num_elements = 0;
+    size_t num_bytes = 0;  // > 0 iff mapped
+    bool is_file_backed = false;
+
+    [[ noreturn ]] static void throwErrno(const std::string &msg) {
+        throw std::runtime_error(msg + ": " + std::strerror(errno));
+    }
+
+    void unmap() {
+        if (this->num_bytes > 0) ::munmap(this->ptr, this->num_bytes);
+        this->num_bytes = 0;
+        this->ptr = nullptr;
+        this->is_file_backed = false;
+    }
+
+    /// @brief Pages are zeroed lazily by the kernel on first touch.
+    void mapAnonymous(const size_t bytes) {
+        const size_t len = (bytes + huge_page_bytes - 1)
+                         / huge_page_bytes * huge_page_bytes;
+        constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        void *mapped = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                              flags | MAP_HUGETLB, -1, 0);
+        if (mapped == MAP_FAILED) {
+            // no explicit huge pages reserved, over-map to align for THP
+            mapped = ::mmap(nullptr, len + huge_page_bytes,
+                            PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (mapped == MAP_FAILED) {
+                throwErrno("Failed to map " + std::to_string(len) + " B");
+            }
+            char * const raw = static_cast<char *>(mapped);
+            const size_t lead = (huge_page_bytes
+                              - reinterpret_cast<uintptr_t>(raw) % huge_page_bytes)
+                              % huge_page_bytes;
+            if (lead > 0) ::munmap(raw, lead);
+            ::munmap(raw + lead + len, huge_page_bytes - lead);
+            mapped = raw + lead;
+            ::madvise(mapped, len, MADV_HUGEPAGE);
+        }
+        interleaveNumaNodes(mapped, len);
+        this->ptr = static_cast<T *>(mapped);
+        this->num_bytes = len;
+    }
+
+    /// @brief Layers are read and written at scattered ranks from all
+    ///        threads, so pages are spread evenly rather than bound.
+    static void interleaveNumaNodes(void * const addr, const size_t len) {
+        static const unsigned long node_mask = [] () {
+            // e.g. "0-1,3"
+            std::ifstream file("/sys/devices/system/node/online");
+            unsigned long mask = 0UL;
+            int first = 0;
+            char sep = ',';
+            while (sep == ',' && file >> first) {
+                int last = first;
+                if (file.peek() == '-') file >> sep >> last;
+                for (int node = first; node <= last && node < 64; ++node) {
+                    mask |= 1UL << node;
+                }
+                if (!(file >> sep)) break;
+            }
+            return mask;
+        }();
+        if (__builtin_popcountl(node_mask) < 2) return;
+        constexpr int mpol_interleave = 3;  // MPOL_INTERLEAVE, numaif.h
+        // best effort, e.g. fails if kernel has no NUMA support
+        ::syscall(SYS_mbind, addr, len, mpol_interleave,
+                  &node_mask, sizeof(node_mask) * 8, 0);
+    }
+
+    /// @return false if not file backed or [begin, end) has no whole page
+    bool pagesWithin(const size_t begin, const size_t end,
+                     void * &page_begin, size_t &len) const {
+        if (!this->is_file_backed) return false;
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        const size_t first = (begin * sizeof(T) + page - 1) / page * page;
+        const size_t last = std::min(end * sizeof(T), this->num_bytes)
+                          / page * page;
+        if (first >= last) return false;
+        page_begin = reinterpret_cast<char *>(this->ptr) + first;
+        len = last - first;
+        return true;
+    }
+
+    void advise(const size_t begin, const size_t end, const int advice) const {
+        if (!this->is_file_backed) return;
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        const size_t first = begin * sizeof(T) / page * page;
+        const size_t last = std::min(end * sizeof(T), this->num_bytes);
+        if (first >= last) return;
+        ::madvise(reinterpret_cast<char *>(this->ptr) + first,
+                  last - first, advice);
+    }
+
+};
+
+/**
+ * @brief DP layer of costs of (set, end) states, ends of a set are a
+ *        contiguous block at rank * cardinality.
+ *        If delta_t is narrower than T, every block is stored as a wide
+ *        base, its min, and narrow deltas from it per end. The max of
+ *        delta_t marks a state that is dead, either it cannot complete
+ *        below the bound or it is too far above its base. A state more
+ *        than the span of any weights column above another end of the
+ *        same set is never on an optimal path, so if that span is below
+ *        the max of delta_t no optimal state is lost.
+ *        If delta_t is a half float, T is float and every cost is stored
+ *        rounded to it, see detail::float16 and detail::bfloat16.
+ */
+template<typename T, typename delta_t = T>
+class CostLayer {
+ public:
+
+    static constexpr bool is_compressed = !std::is_same_v<T, delta_t>;
+    static constexpr bool is_half = is_half_float_v<delta_t>;
+    static constexpr bool has_bases = is_compressed && !is_half;
+    static_assert(!is_half || std::is_same_v<T, float>,
+                  "Half floats are computed in float.");
+    static_assert(!has_bases || ( std::is_unsigned_v<T>
+                               && std::is_unsigned_v<delta_t>
+                               && sizeof(delta_t) < sizeof(T) ),
+                  "Deltas must be unsigned and narrower than costs.");
+    static constexpr T inf = std::numeric_limits<T>::max();
+    static constexpr delta_t dead = std::numeric_limits<delta_t>::max();
+
+    void allocate(const size_t num_sets, const int cardinality,
+                  const std::string &backing_dir) {
+        this->entries.allocate(num_sets * cardinality, backing_dir);
+        if constexpr (has_bases) {
+            this->bases.allocate(num_sets, backing_dir);
+        }
+    }
+
+    void release() {
+        this->entries.release();
+        this->bases.release();
+    }
+
+    [[ nodiscard ]] bool isFileBacked() const noexcept {
+        return this->entries.isFileBacked();
+    }
+
+    /// @brief Only if not compressed, entries are costs.
+    [[ nodiscard ]] T * data() noexcept
+        requires (!is_compressed) { return this->entries.data(); }
+
+    /// @return costs of the set's ends, decoded into buf if compressed
+    [[ gnu::hot, gnu::always_inline ]]
+    const T * block(const size_t rank, const int cardinality,
+                    T * __restrict const buf) const noexcept {
+        const delta_t * const block = this->entries.data() + rank * cardinality;
+        if constexpr (!is_compressed) {
+            return block;
+        } else if constexpr (is_half) {
+            for (int i = 0; i < cardinality; ++i) {
+                buf[i] = static_cast<T>(block[i]);
+            }
+            return buf;
+        } else {
+            const T base = this->bases[rank];
+            for (int i = 0; i < cardinality; ++i) {
+                buf[i] = block[i] == dead ? inf : base + block[i];
+            }
+            return buf;
+        }
+    }
+
+    [[ gnu::hot, gnu::always_inline ]]
+    T entry(const size_t rank, const int cardinality,
+            const int end_idx) const noexcept {
+        const delta_t cost = this->entries[rank * cardinality + end_idx];
+        if constexpr (!is_compressed) {
+            return cost;
+        } else if constexpr (is_half) {
+            return static_cast<T>(cost);
+        } else {
+            return cost == dead ? inf : this->bases[rank] + cost;
+        }
+    }
+
+    [[ gnu::hot, gnu::always_inline ]]
+    void storeBlock(const size_t rank, const int cardinality,
+                    const T * __restrict const costs) noexcept {
+        delta_t * const block = this->entries.data() + rank * cardinality;
+        if constexpr (!is_compressed) {
+            std::copy_n(costs, cardinality, block);
+        } else if constexpr (is_half) {
+            for (int i = 0; i < cardinality; ++i) {
+                block[i] = static_cast<delta_t>(costs[i]);
+            }
+        } else {
+            const T base = *std::min_element(costs, costs + cardinality);
+            this->bases[rank] = base;
+            for (int i = 0; i < cardinality; ++i) {
+                const T delta = costs[i] - base;
+                block[i] = costs[i] == inf || delta >= static_cast<T>(dead)
+                         ? dead : static_cast<delta_t>(delta);
+            }
+        }
+    }
+
+    template<typename pool_t>
+    void firstTouch(pool_t &pool) {
+        this->entries.firstTouch(pool);
+        this->bases.firstTouch(pool);
+    }
+
+    /// @brief Hint that sets [begin, end) are about to be read in order.
+    void adviseSequential(const size_t begin, const size_t end,
+                          const int cardinality) const {
+        this->entries.adviseSequential(begin * cardinality, end * cardinality);
+        this->bases.adviseSequential(begin, end);
+    }
+
+    /// @brief Sets [begin, end) will not be read before being rewritten.
+    void discard(const size_t begin, const size_t end,
+                 const int cardinality) const {
+        this->entries.discard(begin * cardinality, end * cardinality);
+        this->bases.discard(begin, end);
+    }
+
+    /// @brief Calls fn(bytes, num_bytes) on raw contents of sets
+    ///        [0, num_sets), entries and then bases, e.g. to checkpoint.
+    template<typename fn_t>
+    void forEachRawBlock(const size_t num_sets, const int cardinality,
+                         fn_t &&fn) {
+        fn(reinterpret_cast<char *>(this->entries.data()),
+           num_sets * cardinality * sizeof(delta_t));
+        if constexpr (has_bases) {
+            fn(reinterpret_cast<char *>(this->bases.data()),
+               num_sets * sizeof(T));
+        }
+    }
+
+ private:
+
+    LayerBuffer<delta_t> entries;  // costs, deltas if has_bases
+    LayerBuffer<T> bases;  // [rank], only if has_bases
+
+};
+
+}  // detail namesspace
+
+#endif
@@ -4,10 +4,13 @@
 #include <limits>
 #include <chrono>
 #include <variant>
+#include <optional>
 
 #include "dtype_selector.hpp"
 #include "scaler.hpp"
 #include "bellman_held_karp.hpp"
+#include "upper_bound.hpp"
+#include "layer_progress.hpp"
 #include "../common/timing.hpp"
 #include "../common/problem_loader.hpp"
 
@@ -23,6 +26,14 @@ void Solve(
     const bool do_not_prefer_cost_t_int,
     const bool is_symmetric,
     const bool cost_only,
+    const int num_threads,
+    const std::string &layers_dir,
+    const bool recompute_path,
+    const int delta_bytes,
+    const bool bidirectional,
+    const std::string &checkpoint_dir,
+    const bool all_prefixes,
+    const std::string &progress_log,
     const int verbose,
     const unsigned int seed
 );
@@ -44,12 +55,22 @@ void logFoundSolutionCostOnly(
     const int num_edges
 );
 
-template<typename cost_t, typename vertex_t>
+template<typename cost_t, typename vertex_t, typename delta_t = cost_t>
+uint64_t calcBytesNeeded(
+    const int n,
+    const bool cycle,
+    const bool is_symmetric,
+    const bool cost_only,
+    const bool bidirectional
+);
+
+template<typename cost_t, typename vertex_t, typename delta_t = cost_t>
 void logMemoryUsage(
     const int n,
     const bool cycle,
     const bool is_symmetric,
-    const bool cost_only
+    const bool cost_only,
+    const bool bidirectional
 );
 
 
@@ -80,6 +101,29 @@ int main(const int argc, const char **argv)
     const bool is_problem_in_pts_format = argc < 10
                                         ? true  // not TSPLIB format by default
                                         : std::atoi(argv[9]);
+    // 0 to use all hardware threads
+    const int num_threads = argc < 11 ? 1 : std::atoi(argv[10]);
+    // if given, layers are memory-mapped files in this directory (e.g. on
+    // NVMe) and the memory constraint applies to the disk space used
+    const std::string layers_dir = argc < 12 ? "" : argv[11];
+    // iff 1 then path is found without storing previous vertices, by
+    // solving each half again, at memory of cost only search
+    const bool recompute_path = argc < 13 ? false : std::atoi(argv[12]);
+    // iff 1 or 2 then layers store a uint16_t/uint32_t base per set and
+    // uint8_t/uint16_t deltas per its ends, weights are scaled to fit
+    // deltas and sums are exact
+    const int delta_bytes = argc < 14 ? 0 : std::atoi(argv[13]);
+    // iff true asymmetric instances are solved from both ends to n / 2
+    const bool bidirectional = argc < 15 ? false : std::atoi(argv[14]);
+    // if given, finished layers are saved there and a rerun of a killed
+    // run continues from the last one
+    const std::string checkpoint_dir = argc < 16 ? "" : argv[15];
+    // iff 1 then every prefix of 1 to num_points points is solved in a
+    // single unmerged run over all of them, each logged as a run of its own
+    const bool all_prefixes = argc < 17 ? false : std::atoi(argv[16]);
+    // if given, each finished layer is written there as a JSON line with
+    // its time, rates, RSS, page faults and ETA, a file or a named pipe
+    const std::string progress_log = argc < 18 ? "" : argv[17];
     const bool cost_only = false;  // iff cost only then no optimal path returned
 
     std::cout << "Solving "
@@ -116,6 +160,14 @@ int main(const int argc, const char **argv)
                     do_not_prefer_cost_t_int,
                     is_symmetric,
                     cost_only,
+                    num_threads,
+                    layers_dir,
+                    recompute_path,
+                    delta_bytes,
+                    bidirectional,
+                    checkpoint_dir,
+                    all_prefixes,
+                    progress_log,
                     run_idx == 1 ? 1 : 0,  // verbose only for first run
                     run_idx
                 );
@@ -154,56 +206,159 @@ void Solve(
     const bool do_not_prefer_cost_t_int,
     const bool is_symmetric,
     const bool cost_only,
+    const int num_threads,
+    const std::string &layers_dir,
+    const bool recompute_path,
+    const int delta_bytes,
+    const bool bidirectional,
+    const std::string &checkpoint_dir,
+    const bool all_prefixes,
+    const std::string &progress_log,
     const int verbose,
     const unsigned int seed
 ) {
+    if (all_prefixes && (recompute_path || bidirectional
+                      || !checkpoint_dir.empty())) {
+        throw std::invalid_argument(
+            "All prefixes are solved in a single run, without recomputed"
+            " paths, bidirectional runs or checkpoints."
+        );
+    }
+    // prefixes need every layer, so symmetric halves are not merged
+    const bool is_merged_symmetric = is_symmetric && !all_prefixes;
     boost::random::mt19937 psrng = random::initPSRNG(seed);
     const distance_t max_cost = detail::estimateMaxPossibleCost(
         distances, is_finding_cycle, psrng, 10
     );
+    // k-opt tour bounds the exact search which prunes states against it
+    const std::vector<int> heuristic_tour = detail::findHeuristicTour(
+        distances, is_finding_cycle, is_symmetric, seed
+    );
     const int num_points = distances.size();
     const int num_edges = is_finding_cycle ? num_points
                                            : num_points - 1;
     const distance_t max_cost_norm = max_dist - min_dist <= 0
                                 ? (distance_t) 0
                                 : (max_cost - min_dist * num_edges);
-    const auto cost_t_variant = chooseCostType<distance_t>(
-        precision, max_cost_norm, num_points, max_num_bytes,
-        do_not_prefer_cost_t_int, is_finding_cycle, is_symmetric,
-        cost_only, verbose, false
-    );
-
-    std::visit([&] (auto &&cost_t_variant) {
-        using cost_t = std::decay_t<decltype(cost_t_variant)>;
+    const auto solve = [&] <typename cost_t, typename delta_t> () {
         using vertex_t = uint8_t;
+        constexpr bool is_compressed = !std::is_same_v<cost_t, delta_t>;
         const int num_points = distances.size();
+        // memory needed for recomputed path is the same as for cost only
         if (verbose > 0) {
-            logMemoryUsage<cost_t, vertex_t>(
-                num_points, is_finding_cycle, is_symmetric, cost_only
+            logMemoryUsage<cost_t, vertex_t, delta_t>(
+                num_points, is_finding_cycle, is_merged_symmetric,
+                cost_only || recompute_path, bidirectional
+            );
+        }
+        if ( is_compressed
+          && calcBytesNeeded<cost_t, vertex_t, delta_t>(
+                num_points, is_finding_cycle, is_merged_symmetric,
+                cost_only || recompute_path, bidirectional
+             ) > max_num_bytes
+        ) {
+            throw std::runtime_error(
+                "Not enough memory provided for compressed layers."
             );
         }
         double scaling_factor = 1.;
-        const std::vector<std::vector<cost_t>> scaled_distances
-            = ( std::is_floating_point_v<cost_t>
-             || max_cost_norm <= (distance_t) 0 )
-            ? recastMatrix<cost_t, distance_t>(distances)
-            : scaleAndNormalize<cost_t, distance_t>(
+        std::vector<std::vector<cost_t>> scaled_distances;
+        if constexpr (detail::is_half_float_v<delta_t>) {
+            // weights are rounded to the half float, as stored costs are
+            scaled_distances = recastMatrix<cost_t>(
+                scaleAndNormalize<delta_t, distance_t>(
+                    distances, min_dist,
+                    max_cost_norm, precision,
+                    false,  // do not round
+                    scaling_factor,
+                    verbose
+                )
+            );
+        } else if ( std::is_floating_point_v<cost_t>
+                 || max_cost_norm <= (distance_t) 0
+        ) {
+            scaled_distances = recastMatrix<cost_t, distance_t>(distances);
+        } else if constexpr (is_compressed) {
+            // a single edge has to fit into a delta, its sums fit cost_t
+            scaled_distances = recastMatrix<cost_t>(
+                scaleAndNormalize<delta_t, distance_t>(
+                    distances, min_dist,
+                    max_dist - min_dist, precision,
+                    true,  // do round
+                    scaling_factor,
+                    verbose
+                )
+            );
+        } else {
+            scaled_distances = scaleAndNormalize<cost_t, distance_t>(
                 distances, min_dist,
                 max_cost_norm, precision,
                 true,  // do round
                 scaling_factor,
                 verbose
             );
+        }
+        // layers are reported only while it lives, the solver is the same
+        std::optional<detail::LayerProgressLog> progress;
+        if (!progress_log.empty()) {
+            progress.emplace(
+                progress_log,
+                is_finding_cycle ? num_points - 1 : num_points,
+                is_merged_symmetric || bidirectional,
+                bidirectional && !is_symmetric
+            );
+        }
+        if (all_prefixes) {
+            std::vector<std::vector<vertex_t>> paths;
+            const std::vector<cost_t> costs = bellmanHeldKarpPrefixes<
+                cost_t, vertex_t, uint64_t, delta_t
+            >(scaled_distances, is_finding_cycle,
+              cost_only ? nullptr : &paths, num_threads, layers_dir);
+            if (verbose == 0) return;
+            for (int m = 1; m <= num_points; ++m) {
+                if (cost_only) {
+                    logFoundSolutionCostOnly<distance_t>(
+                        costs[m], scaling_factor, min_dist,
+                        m, is_finding_cycle ? m : m - 1
+                    );
+                } else {
+                    logFoundSolutionWithPath<distance_t>(
+                        costs[m], paths[m], m, distances
+                    );
+                }
+            }
+            return;
+        }
+        const cost_t heuristic_cost = detail::calcTourCost(
+            scaled_distances, heuristic_tour, is_finding_cycle
+        );
+        const cost_t upper_bound = detail::boundAbove<cost_t, delta_t>(
+            heuristic_cost, num_edges
+        );
+        if (verbose > 0) {
+            std::cout << "k-opt upper bound (scaled): "
+                      << static_cast<double>(heuristic_cost) << std::endl;
+        }
         std::vector<vertex_t> path;
-        const cost_t cost = bellmanHeldKarp<cost_t, vertex_t, uint64_t>(
+        cost_t cost = bellmanHeldKarp<cost_t, vertex_t, uint64_t, delta_t>(
             path,
             scaled_distances,
             is_finding_cycle,
             is_symmetric,
-            std::numeric_limits<cost_t>::max(),
+            upper_bound,
             true,  // always true since normalized
-            !cost_only
+            !cost_only,
+            num_threads,
+            layers_dir,
+            recompute_path,
+            bidirectional,
+            checkpoint_dir
         );
+        if (cost >= upper_bound) {  // nothing below it, k-opt tour is optimal
+            cost = heuristic_cost;
+            path.assign(heuristic_tour.begin(), heuristic_tour.end());
+            if (is_finding_cycle) path.push_back(path.front());
+        }
 
         if (verbose > 0) {
             if (cost_only) {
@@ -217,6 +372,24 @@ void Solve(
                 );
             }
         }
+    };
+
+    if (delta_bytes == 1) {
+        solve.template operator()<uint16_t, uint8_t>();
+        return;
+    }
+    if (delta_bytes == 2) {
+        solve.template operator()<uint32_t, uint16_t>();
+        return;
+    }
+    const auto cost_t_variant = chooseCostType<distance_t>(
+        precision, max_cost_norm, num_points, max_num_bytes,
+        do_not_prefer_cost_t_int, is_finding_cycle, is_merged_symmetric,
+        cost_only || recompute_path, verbose, false, bidirectional
+    );
+    std::visit([&] (auto &&cost_t_variant) {
+        using cost_t = std::decay_t<decltype(cost_t_variant)>;
+        solve.template operator()<detail::compute_t<cost_t>, cost_t>();
     }, cost_t_variant);
 }
 
@@ -246,18 +419,44 @@ void logFoundSolutionWithPath(
     }
 }
 
-template<typename cost_t, typename vertex_t>
+template<typename cost_t, typename vertex_t, typename delta_t>
+uint64_t calcBytesNeeded(
+    const int n,
+    const bool cycle,
+    const bool is_symmetric,
+    const bool cost_only,
+    const bool bidirectional
+) {
+    const auto space = calcSpaceNeeded(n, cycle, is_symmetric, cost_only,
+                                       bidirectional);
+    if constexpr (!detail::CostLayer<cost_t, delta_t>::has_bases) {
+        return sizeof(vertex_t) * space.first + sizeof(delta_t) * space.second;
+    } else {  // a base per set and a delta per its end
+        return sizeof(vertex_t) * space.first
+             + sizeof(cost_t) * calcNumCostSets(n, cycle, is_symmetric,
+                                                cost_only, bidirectional)
+             + sizeof(delta_t) * space.second;
+    }
+}
+
+template<typename cost_t, typename vertex_t, typename delta_t>
 void logMemoryUsage(
     const int n,
     const bool cycle,
     const bool is_symmetric,
-    const bool cost_only
+    const bool cost_only,
+    const bool bidirectional
 ) {
-    const auto space = calcSpaceNeeded(n, cycle, is_symmetric, cost_only);
-    const uint64_t bytes_to_use = sizeof(vertex_t) * space.first
-                                + sizeof(cost_t) * space.second;
-    std::cout << "Solving with cost_t = " << typeid(cost_t).name()
-              << std::endl << "Memory [GB] needed: "
+    const uint64_t bytes_to_use = calcBytesNeeded<cost_t, vertex_t, delta_t>(
+        n, cycle, is_symmetric, cost_only, bidirectional
+    );
+    std::cout << "Solving with cost_t = " << typeid(cost_t).name();
+    if constexpr (detail::is_half_float_v<delta_t>) {
+        std::cout << ", stored as " << detail::storageName<delta_t>();
+    } else if constexpr (!std::is_same_v<cost_t, delta_t>) {
+        std::cout << ", deltas of " << typeid(delta_t).name();
+    }
+    std::cout << std::endl << "Memory [GB] needed: "
               << (1. * bytes_to_use / (1 << 30)) << std::endl;
 }
 
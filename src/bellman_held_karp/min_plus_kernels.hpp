@@ -0,0 +1,687 @@
+#ifndef MIN_PLUS_KERNELS_HPP
+#define MIN_PLUS_KERNELS_HPP
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <immintrin.h>
+
+namespace detail {
+namespace min_plus {
+
+enum class Isa { scalar, avx2, avx512 };
+
+/// @brief Best instruction set supported by the running CPU.
+inline Isa detectIsa() {
+    static const Isa isa = [] () {
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx512f")
+          && __builtin_cpu_supports("avx512bw")
+        ) {
+            return Isa::avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) return Isa::avx2;
+        return Isa::scalar;
+    }();
+    return isa;
+}
+
+/// unsigned integer of T's width, holds a source vertex per SIMD lane
+template<typename T>
+using lane_idx_t = std::conditional_t<sizeof(T) == 1, uint8_t,
+                   std::conditional_t<sizeof(T) == 2, uint16_t,
+                   std::conditional_t<sizeof(T) == 4, uint32_t,
+                                                      uint64_t>>>;
+
+template<typename T>
+constexpr bool has_kernels_v = std::is_same_v<T, uint8_t>
+                            || std::is_same_v<T, uint16_t>
+                            || std::is_same_v<T, uint32_t>
+                            || std::is_same_v<T, uint64_t>
+                            || std::is_same_v<T, float>
+                            || std::is_same_v<T, double>;
+
+/// num of T's in a cache line, rows of the weights matrix are padded to it
+template<typename T>
+constexpr int row_align_v = 64 / static_cast<int>(sizeof(T));
+
+/**
+ * @brief For all d in [0, num_dsts):
+ *        best[d] = min_i costs[i] + weights[srcs[i] * stride + d],
+ *        best_src[d] = first srcs[i] reaching it.
+ *        Sums saturate at max of T, so best[d] stays max and best_src[d]
+ *        stays 0 iff no sum is below it, as in scalar store_sum_iflt.
+ * @param stride - multiple of row_align_v<T>, >= num_dsts, best and
+ *                 best_src must have room for stride elements.
+ */
+template<typename T>
+using relax_dsts_t = void (*)(
+    const T * __restrict costs,
+    const uint8_t * __restrict srcs,
+    int num_srcs,
+    const T * __restrict weights,
+    int stride,
+    int num_dsts,
+    T * __restrict best,
+    lane_idx_t<T> * __restrict best_src
+);
+
+/**
+ * @brief Lowers cost to min_i costs[i] + weights[offsets[i]] iff lower.
+ * @return First i reaching the new cost, -1 if cost was not lowered.
+ */
+template<typename T>
+using relax_srcs_t = int (*)(
+    const T * __restrict costs,
+    const int32_t * __restrict offsets,
+    int num_srcs,
+    const T * __restrict weights,
+    T &cost
+);
+
+
+// ============================================================
+// AVX2 lane operations:
+
+#define MIN_PLUS_AVX2 gnu::target("avx2"), gnu::always_inline
+
+template<typename T> struct Avx2Ops;
+
+template<> struct Avx2Ops<double> {
+    using vec = __m256d;
+    static constexpr int lanes = 4;
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1(const double x) {
+        return _mm256_set1_pd(x);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline __m256i set1_idx(const uint64_t i) {
+        return _mm256_set1_epi64x(static_cast<long long>(i));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec load(const double *p) {
+        return _mm256_loadu_pd(p);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store(double *p, const vec v) {
+        _mm256_storeu_pd(p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store_idx(uint64_t *p, const __m256i v) {
+        _mm256_storeu_si256((__m256i *) p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec add(const vec x, const vec y) {
+        return _mm256_add_pd(x, y);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec gather(
+        const double *base, const int32_t *offsets
+    ) {
+        return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base,
+            _mm_loadu_si128((const __m128i *) offsets),
+            _mm256_castsi256_pd(_mm256_set1_epi64x(-1LL)), 8);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void relax(
+        vec &best, __m256i &arg, const vec s, const __m256i src
+    ) {
+        const vec lt = _mm256_cmp_pd(s, best, _CMP_LT_OQ);
+        best = _mm256_blendv_pd(best, s, lt);
+        arg = _mm256_blendv_epi8(arg, src, _mm256_castpd_si256(lt));
+    }
+};
+
+template<> struct Avx2Ops<float> {
+    using vec = __m256;
+    static constexpr int lanes = 8;
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1(const float x) {
+        return _mm256_set1_ps(x);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline __m256i set1_idx(const uint32_t i) {
+        return _mm256_set1_epi32(static_cast<int>(i));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec load(const float *p) {
+        return _mm256_loadu_ps(p);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store(float *p, const vec v) {
+        _mm256_storeu_ps(p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store_idx(uint32_t *p, const __m256i v) {
+        _mm256_storeu_si256((__m256i *) p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec add(const vec x, const vec y) {
+        return _mm256_add_ps(x, y);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec gather(
+        const float *base, const int32_t *offsets
+    ) {
+        return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base,
+            _mm256_loadu_si256((const __m256i *) offsets),
+            _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void relax(
+        vec &best, __m256i &arg, const vec s, const __m256i src
+    ) {
+        const vec lt = _mm256_cmp_ps(s, best, _CMP_LT_OQ);
+        best = _mm256_blendv_ps(best, s, lt);
+        arg = _mm256_blendv_epi8(arg, src, _mm256_castps_si256(lt));
+    }
+};
+
+template<> struct Avx2Ops<uint8_t> {
+    using vec = __m256i;
+    static constexpr int lanes = 32;
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1(const uint8_t x) {
+        return _mm256_set1_epi8(static_cast<char>(x));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1_idx(const uint8_t i) {
+        return set1(i);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec load(const uint8_t *p) {
+        return _mm256_loadu_si256((const __m256i *) p);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store(uint8_t *p, const vec v) {
+        _mm256_storeu_si256((__m256i *) p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store_idx(uint8_t *p, const vec v) {
+        store(p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec add(const vec x, const vec y) {
+        return _mm256_adds_epu8(x, y);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void relax(
+        vec &best, vec &arg, const vec s, const vec src
+    ) {
+        const vec new_best = _mm256_min_epu8(s, best);
+        const vec same = _mm256_cmpeq_epi8(new_best, best);
+        arg = _mm256_blendv_epi8(src, arg, same);
+        best = new_best;
+    }
+};
+
+template<> struct Avx2Ops<uint16_t> {
+    using vec = __m256i;
+    static constexpr int lanes = 16;
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1(const uint16_t x) {
+        return _mm256_set1_epi16(static_cast<short>(x));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1_idx(const uint16_t i) {
+        return set1(i);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec load(const uint16_t *p) {
+        return _mm256_loadu_si256((const __m256i *) p);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store(uint16_t *p, const vec v) {
+        _mm256_storeu_si256((__m256i *) p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store_idx(uint16_t *p, const vec v) {
+        store(p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec add(const vec x, const vec y) {
+        return _mm256_adds_epu16(x, y);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void relax(
+        vec &best, vec &arg, const vec s, const vec src
+    ) {
+        const vec new_best = _mm256_min_epu16(s, best);
+        const vec same = _mm256_cmpeq_epi16(new_best, best);
+        arg = _mm256_blendv_epi8(src, arg, same);
+        best = new_best;
+    }
+};
+
+template<> struct Avx2Ops<uint32_t> {
+    using vec = __m256i;
+    static constexpr int lanes = 8;
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1(const uint32_t x) {
+        return _mm256_set1_epi32(static_cast<int>(x));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1_idx(const uint32_t i) {
+        return set1(i);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec load(const uint32_t *p) {
+        return _mm256_loadu_si256((const __m256i *) p);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store(uint32_t *p, const vec v) {
+        _mm256_storeu_si256((__m256i *) p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store_idx(uint32_t *p, const vec v) {
+        store(p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec add(const vec x, const vec y) {
+        const vec sum = _mm256_add_epi32(x, y);
+        // wrapped around iff sum < x, then saturate to all ones
+        const vec no_wrap = _mm256_cmpeq_epi32(_mm256_max_epu32(sum, x), sum);
+        return _mm256_or_si256(sum, _mm256_xor_si256(
+            no_wrap, _mm256_set1_epi32(-1)));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec gather(
+        const uint32_t *base, const int32_t *offsets
+    ) {
+        return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(),
+            (const int *) base, _mm256_loadu_si256((const __m256i *) offsets),
+            _mm256_set1_epi32(-1), 4);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void relax(
+        vec &best, vec &arg, const vec s, const vec src
+    ) {
+        const vec new_best = _mm256_min_epu32(s, best);
+        const vec same = _mm256_cmpeq_epi32(new_best, best);
+        arg = _mm256_blendv_epi8(src, arg, same);
+        best = new_best;
+    }
+};
+
+template<> struct Avx2Ops<uint64_t> {
+    using vec = __m256i;
+    static constexpr int lanes = 4;
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1(const uint64_t x) {
+        return _mm256_set1_epi64x(static_cast<long long>(x));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec set1_idx(const uint64_t i) {
+        return set1(i);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec load(const uint64_t *p) {
+        return _mm256_loadu_si256((const __m256i *) p);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store(uint64_t *p, const vec v) {
+        _mm256_storeu_si256((__m256i *) p, v);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void store_idx(uint64_t *p, const vec v) {
+        store(p, v);
+    }
+    // no unsigned 64bit compare in AVX2, compare with flipped sign bits
+    [[ MIN_PLUS_AVX2 ]] static inline vec lt(const vec x, const vec y) {
+        const vec sign = _mm256_set1_epi64x(
+            static_cast<long long>(1ULL << 63));
+        return _mm256_cmpgt_epi64(_mm256_xor_si256(y, sign),
+                                  _mm256_xor_si256(x, sign));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec add(const vec x, const vec y) {
+        const vec sum = _mm256_add_epi64(x, y);
+        return _mm256_or_si256(sum, lt(sum, x));
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline vec gather(
+        const uint64_t *base, const int32_t *offsets
+    ) {
+        return _mm256_mask_i32gather_epi64(_mm256_setzero_si256(),
+            (const long long *) base, _mm_loadu_si128((const __m128i *) offsets),
+            _mm256_set1_epi64x(-1LL), 8);
+    }
+    [[ MIN_PLUS_AVX2 ]] static inline void relax(
+        vec &best, vec &arg, const vec s, const vec src
+    ) {
+        const vec is_lt = lt(s, best);
+        best = _mm256_blendv_epi8(best, s, is_lt);
+        arg = _mm256_blendv_epi8(arg, src, is_lt);
+    }
+};
+
+#undef MIN_PLUS_AVX2
+
+
+// ============================================================
+// AVX-512 (F + BW) lane operations:
+
+#define MIN_PLUS_AVX512 gnu::target("avx512f,avx512bw"), gnu::always_inline
+
+template<typename T> struct Avx512Ops;
+
+template<> struct Avx512Ops<double> {
+    using vec = __m512d;
+    static constexpr int lanes = 8;
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1(const double x) {
+        return _mm512_set1_pd(x);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline __m512i set1_idx(const uint64_t i) {
+        return _mm512_set1_epi64(static_cast<long long>(i));
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec load(const double *p) {
+        return _mm512_loadu_pd(p);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store(double *p, const vec v) {
+        _mm512_storeu_pd(p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store_idx(uint64_t *p, const __m512i v) {
+        _mm512_storeu_si512((void *) p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec add(const vec x, const vec y) {
+        return _mm512_add_pd(x, y);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec gather(
+        const double *base, const int32_t *offsets
+    ) {
+        return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF,
+            _mm256_loadu_si256((const __m256i *) offsets), base, 8);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void relax(
+        vec &best, __m512i &arg, const vec s, const __m512i src
+    ) {
+        const __mmask8 lt = _mm512_cmp_pd_mask(s, best, _CMP_LT_OQ);
+        best = _mm512_mask_mov_pd(best, lt, s);
+        arg = _mm512_mask_mov_epi64(arg, lt, src);
+    }
+};
+
+template<> struct Avx512Ops<float> {
+    using vec = __m512;
+    static constexpr int lanes = 16;
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1(const float x) {
+        return _mm512_set1_ps(x);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline __m512i set1_idx(const uint32_t i) {
+        return _mm512_set1_epi32(static_cast<int>(i));
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec load(const float *p) {
+        return _mm512_loadu_ps(p);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store(float *p, const vec v) {
+        _mm512_storeu_ps(p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store_idx(uint32_t *p, const __m512i v) {
+        _mm512_storeu_si512((void *) p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec add(const vec x, const vec y) {
+        return _mm512_add_ps(x, y);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec gather(
+        const float *base, const int32_t *offsets
+    ) {
+        return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF,
+            _mm512_loadu_si512((const void *) offsets), base, 4);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void relax(
+        vec &best, __m512i &arg, const vec s, const __m512i src
+    ) {
+        const __mmask16 lt = _mm512_cmp_ps_mask(s, best, _CMP_LT_OQ);
+        best = _mm512_mask_mov_ps(best, lt, s);
+        arg = _mm512_mask_mov_epi32(arg, lt, src);
+    }
+};
+
+template<> struct Avx512Ops<uint8_t> {
+    using vec = __m512i;
+    static constexpr int lanes = 64;
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1(const uint8_t x) {
+        return _mm512_set1_epi8(static_cast<char>(x));
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1_idx(const uint8_t i) {
+        return set1(i);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec load(const uint8_t *p) {
+        return _mm512_loadu_si512((const void *) p);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store(uint8_t *p, const vec v) {
+        _mm512_storeu_si512((void *) p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store_idx(uint8_t *p, const vec v) {
+        store(p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec add(const vec x, const vec y) {
+        return _mm512_adds_epu8(x, y);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void relax(
+        vec &best, vec &arg, const vec s, const vec src
+    ) {
+        const __mmask64 lt = _mm512_cmplt_epu8_mask(s, best);
+        best = _mm512_mask_mov_epi8(best, lt, s);
+        arg = _mm512_mask_mov_epi8(arg, lt, src);
+    }
+};
+
+template<> struct Avx512Ops<uint16_t> {
+    using vec = __m512i;
+    static constexpr int lanes = 32;
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1(const uint16_t x) {
+        return _mm512_set1_epi16(static_cast<short>(x));
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1_idx(const uint16_t i) {
+        return set1(i);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec load(const uint16_t *p) {
+        return _mm512_loadu_si512((const void *) p);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store(uint16_t *p, const vec v) {
+        _mm512_storeu_si512((void *) p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store_idx(uint16_t *p, const vec v) {
+        store(p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec add(const vec x, const vec y) {
+        return _mm512_adds_epu16(x, y);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void relax(
+        vec &best, vec &arg, const vec s, const vec src
+    ) {
+        const __mmask32 lt = _mm512_cmplt_epu16_mask(s, best);
+        best = _mm512_mask_mov_epi16(best, lt, s);
+        arg = _mm512_mask_mov_epi16(arg, lt, src);
+    }
+};
+
+template<> struct Avx512Ops<uint32_t> {
+    using vec = __m512i;
+    static constexpr int lanes = 16;
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1(const uint32_t x) {
+        return _mm512_set1_epi32(static_cast<int>(x));
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1_idx(const uint32_t i) {
+        return set1(i);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec load(const uint32_t *p) {
+        return _mm512_loadu_si512((const void *) p);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store(uint32_t *p, const vec v) {
+        _mm512_storeu_si512((void *) p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store_idx(uint32_t *p, const vec v) {
+        store(p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec add(const vec x, const vec y) {
+        const vec sum = _mm512_add_epi32(x, y);
+        return _mm512_mask_mov_epi32(sum, _mm512_cmplt_epu32_mask(sum, x),
+                                     _mm512_set1_epi32(-1));
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec gather(
+        const uint32_t *base, const int32_t *offsets
+    ) {
+        return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF,
+            _mm512_loadu_si512((const void *) offsets), base, 4);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void relax(
+        vec &best, vec &arg, const vec s, const vec src
+    ) {
+        const __mmask16 lt = _mm512_cmplt_epu32_mask(s, best);
+        best = _mm512_mask_mov_epi32(best, lt, s);
+        arg = _mm512_mask_mov_epi32(arg, lt, src);
+    }
+};
+
+template<> struct Avx512Ops<uint64_t> {
+    using vec = __m512i;
+    static constexpr int lanes = 8;
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1(const uint64_t x) {
+        return _mm512_set1_epi64(static_cast<long long>(x));
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec set1_idx(const uint64_t i) {
+        return set1(i);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec load(const uint64_t *p) {
+        return _mm512_loadu_si512((const void *) p);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store(uint64_t *p, const vec v) {
+        _mm512_storeu_si512((void *) p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void store_idx(uint64_t *p, const vec v) {
+        store(p, v);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec add(const vec x, const vec y) {
+        const vec sum = _mm512_add_epi64(x, y);
+        return _mm512_mask_mov_epi64(sum, _mm512_cmplt_epu64_mask(sum, x),
+                                     _mm512_set1_epi64(-1LL));
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline vec gather(
+        const uint64_t *base, const int32_t *offsets
+    ) {
+        return _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), 0xFF,
+            _mm256_loadu_si256((const __m256i *) offsets), base, 8);
+    }
+    [[ MIN_PLUS_AVX512 ]] static inline void relax(
+        vec &best, vec &arg, const vec s, const vec src
+    ) {
+        const __mmask8 lt = _mm512_cmplt_epu64_mask(s, best);
+        best = _mm512_mask_mov_epi64(best, lt, s);
+        arg = _mm512_mask_mov_epi64(arg, lt, src);
+    }
+};
+
+#undef MIN_PLUS_AVX512
+
+
+// ============================================================
+// Kernels, same bodies compiled once per instruction set:
+
+#define MIN_PLUS_RELAX_DSTS_BODY \
+    using ops = ops_t<T>; \
+    constexpr T inf = std::numeric_limits<T>::max(); \
+    for (int d = 0; d < num_dsts; d += ops::lanes) { \
+        auto best_v = ops::set1(inf); \
+        auto arg_v = ops::set1_idx(0); \
+        for (int i = 0; i < num_srcs; ++i) { \
+            const int src = srcs[i]; \
+            const auto sum = ops::add(ops::set1(costs[i]), \
+                                      ops::load(weights + src * stride + d)); \
+            ops::relax(best_v, arg_v, sum, ops::set1_idx(src)); \
+        } \
+        ops::store(best + d, best_v); \
+        ops::store_idx(best_src + d, arg_v); \
+    }
+
+#define MIN_PLUS_RELAX_SRCS_BODY \
+    using ops = ops_t<T>; \
+    constexpr T inf = std::numeric_limits<T>::max(); \
+    int best_idx = -1; \
+    T best = cost; \
+    int i = 0; \
+    if (num_srcs >= ops::lanes) { \
+        auto best_v = ops::set1(inf); \
+        auto idx_v = ops::set1_idx(0); \
+        for ( ; i + ops::lanes <= num_srcs; i += ops::lanes) { \
+            const auto sum = ops::add( \
+                ops::load(costs + i), ops::gather(weights, offsets + i)); \
+            /* chunk idx per lane, lanes tell the offset within chunk */ \
+            ops::relax(best_v, idx_v, sum, ops::set1_idx(i)); \
+        } \
+        alignas(64) T lane_best[ops::lanes]; \
+        alignas(64) lane_idx_t<T> lane_idx[ops::lanes]; \
+        ops::store(lane_best, best_v); \
+        ops::store_idx(lane_idx, idx_v); \
+        for (int l = 0; l < ops::lanes; ++l) { \
+            const int idx = static_cast<int>(lane_idx[l]) + l; \
+            /* ties go to the first src as in the scalar loop */ \
+            if ( lane_best[l] < best \
+              || (lane_best[l] == best && best_idx > idx) \
+            ) { \
+                best = lane_best[l]; \
+                best_idx = idx; \
+            } \
+        } \
+    } \
+    for ( ; i < num_srcs; ++i) { \
+        const T w = weights[offsets[i]]; \
+        if constexpr (std::is_floating_point_v<T>) { \
+            if (costs[i] + w < best) { best = costs[i] + w; best_idx = i; } \
+        } else { \
+            if (costs[i] < best && w < best - costs[i]) { \
+                best = costs[i] + w; \
+                best_idx = i; \
+            } \
+        } \
+    } \
+    if (best_idx >= 0) cost = best; \
+    return best_idx;
+
+template<typename T, template<typename> class ops_t = Avx2Ops>
+[[ gnu::target("avx2"), gnu::hot ]]
+void relaxDstsAvx2(
+    const T * __restrict costs,
+    const uint8_t * __restrict srcs,
+    const int num_srcs,
+    const T * __restrict weights,
+    const int stride,
+    const int num_dsts,
+    T * __restrict best,
+    lane_idx_t<T> * __restrict best_src
+) {
+    MIN_PLUS_RELAX_DSTS_BODY
+}
+
+template<typename T, template<typename> class ops_t = Avx512Ops>
+[[ gnu::target("avx512f,avx512bw"), gnu::hot ]]
+void relaxDstsAvx512(
+    const T * __restrict costs,
+    const uint8_t * __restrict srcs,
+    const int num_srcs,
+    const T * __restrict weights,
+    const int stride,
+    const int num_dsts,
+    T * __restrict best,
+    lane_idx_t<T> * __restrict best_src
+) {
+    MIN_PLUS_RELAX_DSTS_BODY
+}
+
+template<typename T, template<typename> class ops_t = Avx2Ops>
+[[ gnu::target("avx2"), gnu::hot ]]
+int relaxSrcsAvx2(
+    const T * __restrict costs,
+    const int32_t * __restrict offsets,
+    const int num_srcs,
+    const T * __restrict weights,
+    T &cost
+) {
+    MIN_PLUS_RELAX_SRCS_BODY
+}
+
+template<typename T, template<typename> class ops_t = Avx512Ops>
+[[ gnu::target("avx512f,avx512bw"), gnu::hot ]]
+int relaxSrcsAvx512(
+    const T * __restrict costs,
+    const int32_t * __restrict offsets,
+    const int num_srcs,
+    const T * __restrict weights,
+    T &cost
+) {
+    MIN_PLUS_RELAX_SRCS_BODY
+}
+
+#undef MIN_PLUS_RELAX_DSTS_BODY
+#undef MIN_PLUS_RELAX_SRCS_BODY
+
+
+/// @return nullptr if there is no kernel for T on given isa
+template<typename T>
+relax_dsts_t<T> selectRelaxDsts(const Isa isa = detectIsa()) {
+    if constexpr (!has_kernels_v<T>) {
+        return nullptr;
+    } else {
+        switch (isa) {
+            case Isa::avx512: return &relaxDstsAvx512<T>;
+            case Isa::avx2:   return &relaxDstsAvx2<T>;
+            default:          return nullptr;
+        }
+    }
+}
+
+/// @return nullptr if there is no kernel for T on given isa,
+///         there are no 8 nor 16 bit gathers
+template<typename T>
+relax_srcs_t<T> selectRelaxSrcs(const Isa isa = detectIsa()) {
+    if constexpr (!has_kernels_v<T> || sizeof(T) < 4) {
+        return nullptr;
+    } else {
+        switch (isa) {
+            case Isa::avx512: return &relaxSrcsAvx512<T>;
+            case Isa::avx2:   return &relaxSrcsAvx2<T>;
+            default:          return nullptr;
+        }
+    }
+}
+
+}  // namespace min_plus
+}  // detail namesspace
+
+#endif
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <limits>
 #include "../common/logging.hpp"
+#include "half_float.hpp"
 
 
 template<typename dst_t, typename src_t>
@@ -22,7 +23,62 @@ std::vector<std::vector<dst_t>> recastMatrix(
     return new_matr;
 }
 
+/**
+ * @brief Half floats keep the same relative precision at any scale, so
+ *        max_cost_norm is only moved to 2^14, two binades below the max
+ *        of float16, for headroom of rounded sums and bounds above them,
+ *        and far above its subnormals. Nothing is rounded to integers.
+ */
 template<typename cost_t, typename distance_t>
+    requires detail::is_half_float_v<cost_t>
+std::vector<std::vector<cost_t>> scaleAndNormalize(
+    const std::vector<std::vector<distance_t>>& weights,
+    const distance_t min_dist,
+    const distance_t max_cost_norm,
+    const double precision,
+    [[ maybe_unused ]] const bool do_round,
+    double &scaling_factor,
+    const int verbose = 0
+) {
+    constexpr double max_normalized = 1 << 14;
+    scaling_factor = max_cost_norm > (distance_t) 0
+                   ? max_normalized / max_cost_norm : 1.;
+    if (precision * max_cost_norm * cost_t::epsilon > 1. && verbose > 0) {
+        std::cout << "Requested precision is too high for "
+                  << cost_t::name << "; differentiates costs by: "
+                  << std::fixed << std::setprecision(6)
+                  << max_cost_norm * cost_t::epsilon
+                  << std::defaultfloat << std::endl;
+    }
+    const cost_t inf(std::numeric_limits<float>::max());
+    std::vector<std::vector<cost_t>> scaled_weights(weights.size());
+    for (int i = 0, n = weights.size(); i < n; ++i) {
+        scaled_weights[i].resize(weights[i].size());
+        for (int j = 0, m = weights[i].size(); j < m; ++j) {
+            if (weights[i][j] <= min_dist) {
+                scaled_weights[i][j] = cost_t(0.f);
+                continue;
+            }
+            if (weights[i][j] - min_dist > max_cost_norm) {
+                scaled_weights[i][j] = inf;
+                continue;
+            }
+            scaled_weights[i][j] = cost_t(static_cast<float>(
+                scaling_factor * (weights[i][j] - min_dist)
+            ));
+        }
+    }
+    if (verbose > 0) {
+        std::cout << "Distances:" << std::endl;
+        logging::displayMatrix(weights);
+        std::cout << "Scaled Distances:" << std::endl;
+        logging::displayMatrix(recastMatrix<double>(scaled_weights));
+    }
+    return scaled_weights;
+}
+
+template<typename cost_t, typename distance_t>
+    requires (!detail::is_half_float_v<cost_t>)
 std::vector<std::vector<cost_t>> scaleAndNormalize(
     const std::vector<std::vector<distance_t>>& weights,
     const distance_t min_dist,
@@ -0,0 +1,348 @@
+#ifndef SPARSE_HELD_KARP_HPP
+#define SPARSE_HELD_KARP_HPP
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstdint>
+#include "subset_rank.hpp"
+
+namespace detail {
+namespace sparse {
+
+/// @brief Instances with at most this fraction of off-diagonal weights
+///        below max of T (i.e. finite) are tried sparse first.
+inline constexpr double max_edge_density = 0.2;
+
+/// @brief Once the layers so far hold more than this fraction of their
+///        dense states, the run is given up for the dense solver.
+inline constexpr double max_layer_fill = 0.25;
+
+/**
+ * @brief Reachable states of sets of a cardinality: sets in increasing
+ *        order, each with a mask of its reachable ends, whose states are
+ *        contiguous from starts[set_idx] in order of the ends.
+ */
+template<typename T, typename vertex_t, typename set_t>
+struct Layer {
+    std::vector<set_t> sets;
+    std::vector<set_t> end_masks;
+    std::vector<uint64_t> starts;  // [set_idx], one past the last too
+    std::vector<T> costs;  // [state], released once extended
+    std::vector<vertex_t> prevs;  // [state], only if path is found
+
+    [[ nodiscard ]] size_t numStates() const noexcept {
+        return this->starts.empty() ? 0 : this->starts.back();
+    }
+
+    /// @return state of set's end, which has to be reachable
+    [[ nodiscard ]] uint64_t find(const set_t set, const vertex_t end) const {
+        const size_t set_idx = std::lower_bound(
+            this->sets.begin(), this->sets.end(), set
+        ) - this->sets.begin();
+        const set_t below_end = (static_cast<set_t>(1) << end) - 1;
+        return this->starts[set_idx]
+             + __builtin_popcountll(this->end_masks[set_idx] & below_end);
+    }
+};
+
+/**
+ * @brief Next layer while it is being relaxed: open addressing table of
+ *        its sets (0 is never a set, so it marks empty slots), each with a
+ *        block of costs of all its ends, packed into a Layer when done.
+ */
+template<typename T, typename vertex_t, typename set_t>
+class LayerBuilder {
+ public:
+
+    static constexpr T inf = std::numeric_limits<T>::max();
+
+    LayerBuilder(const int cardinality, const bool stores_prevs)
+        : cardinality(cardinality), stores_prevs(stores_prevs)
+    {
+        this->rehash(1024);
+    }
+
+    [[ gnu::hot ]]
+    void relax(const set_t set, const vertex_t end, const T cost,
+               const vertex_t prev) {
+        const size_t block = this->findOrInsert(set) * this->cardinality;
+        const int end_idx = __builtin_popcountll(
+            set & ((static_cast<set_t>(1) << end) - 1)
+        );
+        if (cost < this->costs[block + end_idx]) {
+            this->costs[block + end_idx] = cost;
+            if (this->stores_prevs) this->prevs[block + end_idx] = prev;
+        }
+    }
+
+    [[ nodiscard ]] size_t numSets() const noexcept {
+        return this->block_sets.size();
+    }
+
+    /// @brief Only reachable ends are kept, builder is left empty.
+    Layer<T, vertex_t, set_t> pack() {
+        std::vector<uint32_t> order(this->block_sets.size());
+        std::iota(order.begin(), order.end(), 0U);
+        std::sort(order.begin(), order.end(), [this] (const uint32_t a,
+                                                      const uint32_t b) {
+            return this->block_sets[a] < this->block_sets[b];
+        });
+        Layer<T, vertex_t, set_t> layer;
+        layer.sets.reserve(order.size());
+        layer.end_masks.reserve(order.size());
+        layer.starts.reserve(order.size() + 1);
+        layer.starts.push_back(0ULL);
+        for (const uint32_t block_idx : order) {
+            const set_t set = this->block_sets[block_idx];
+            const size_t block = static_cast<size_t>(block_idx)
+                               * this->cardinality;
+            set_t end_mask = (set_t) 0;
+            int end_idx = 0;
+            for (set_t bits = set; bits; bits &= bits - 1, ++end_idx) {
+                const T cost = this->costs[block + end_idx];
+                if (cost == inf) continue;
+                end_mask |= bits & -bits;
+                layer.costs.push_back(cost);
+                if (this->stores_prevs) {
+                    layer.prevs.push_back(this->prevs[block + end_idx]);
+                }
+            }
+            layer.sets.push_back(set);
+            layer.end_masks.push_back(end_mask);
+            layer.starts.push_back(layer.costs.size());
+        }
+        std::vector<set_t>().swap(this->slots);
+        std::vector<uint32_t>().swap(this->slot_blocks);
+        std::vector<set_t>().swap(this->block_sets);
+        std::vector<T>().swap(this->costs);
+        std::vector<vertex_t>().swap(this->prevs);
+        return layer;
+    }
+
+ private:
+
+    const int cardinality;
+    const bool stores_prevs;
+    std::vector<set_t> slots;  // power of 2 of them, at most half full
+    std::vector<uint32_t> slot_blocks;
+    std::vector<set_t> block_sets;
+    std::vector<T> costs;  // [block * cardinality + end_idx]
+    std::vector<vertex_t> prevs;
+
+    [[ gnu::always_inline ]] static size_t hash(const set_t set) noexcept {
+        return static_cast<size_t>(
+            (static_cast<uint64_t>(set) * 0x9E3779B97F4A7C15ULL) >> 17
+        );
+    }
+
+    [[ gnu::hot ]] size_t findOrInsert(const set_t set) {
+        const size_t mask = this->slots.size() - 1;
+        for (size_t slot = hash(set) & mask; ; slot = (slot + 1) & mask) {
+            if (this->slots[slot] == set) return this->slot_blocks[slot];
+            if (this->slots[slot] != (set_t) 0) continue;
+            const size_t block = this->block_sets.size();
+            this->slots[slot] = set;
+            this->slot_blocks[slot] = static_cast<uint32_t>(block);
+            this->block_sets.push_back(set);
+            this->costs.resize(this->costs.size() + this->cardinality, inf);
+            if (this->stores_prevs) {
+                this->prevs.resize(this->prevs.size() + this->cardinality);
+            }
+            if (2 * this->block_sets.size() > this->slots.size()) {
+                this->rehash(2 * this->slots.size());
+            }
+            return block;
+        }
+    }
+
+    void rehash(const size_t num_slots) {
+        this->slots.assign(num_slots, (set_t) 0);
+        this->slot_blocks.assign(num_slots, 0U);
+        const size_t mask = num_slots - 1;
+        for (size_t block = 0; block < this->block_sets.size(); ++block) {
+            size_t slot = hash(this->block_sets[block]) & mask;
+            while (this->slots[slot] != (set_t) 0) slot = (slot + 1) & mask;
+            this->slots[slot] = this->block_sets[block];
+            this->slot_blocks[slot] = static_cast<uint32_t>(block);
+        }
+    }
+
+};
+
+/// @return fraction of off-diagonal weights among the solved vertices
+///         (and from and into start if end_in_starting_point) below inf
+template<typename T>
+double edgeDensity(const std::vector<std::vector<T>> &weights) {
+    constexpr T inf = std::numeric_limits<T>::max();
+    const size_t n = weights.size();
+    if (n < 2) return 1.;
+    size_t num_finite = 0;
+    for (size_t src = 0; src < n; ++src) {
+        for (size_t dst = 0; dst < n; ++dst) {
+            num_finite += src != dst && weights[src][dst] < inf;
+        }
+    }
+    return 1. * num_finite / (n * (n - 1));
+}
+
+/**
+ * @brief Held-Karp over reachable states only, each layer extends only
+ *        the finite edges out of its states' ends, so memory and work
+ *        follow the reachable states rather than n * 2^n.
+ *        Single-threaded, all layers are kept (without costs) if the path
+ *        is found. Gives up as soon as the layers so far hold more
+ *        than max_layer_fill of their dense states.
+ * @param solution - as of bellmanHeldKarp, unchanged if given up
+ * @param best_cost - upper bound, only states below it are kept if
+ *                    has_no_neg_weights, min cost if not given up
+ * @return false iff given up for the dense solver
+ */
+template<typename T, typename vertex_t, typename set_t>
+bool solve(
+    std::vector<vertex_t> &solution,
+    const std::vector<std::vector<T>> &weights,
+    const bool end_in_starting_point,
+    T &best_cost,
+    const bool has_no_neg_weights,
+    const bool find_path
+) {
+    constexpr T inf = std::numeric_limits<T>::max();
+    const int n = end_in_starting_point ? weights.size() - 1
+                                        : weights.size();
+    if (n < 2 || static_cast<int>(sizeof(set_t) * 8) < n) return false;
+    const T bound = has_no_neg_weights ? best_cost : inf;
+    // same overflow checks as the dense solver
+    const auto sum_below = [bound] (const T x, const T y, T &sum) {
+        if constexpr (std::is_same_v<T, uint64_t>) {
+            if (y >= bound || x >= bound - y) return false;
+            sum = x + y;
+            return true;
+        } else {
+            const double dbl_sum = static_cast<double>(x)
+                                 + static_cast<double>(y);
+            if (dbl_sum >= static_cast<double>(bound)) return false;
+            sum = static_cast<T>(dbl_sum);
+            return true;
+        }
+    };
+    const set_t all_vertices = sizeof(set_t) * 8 == n
+                             ? ~(static_cast<set_t>(0))
+                             : (static_cast<set_t>(1) << n) - 1;
+    std::vector<set_t> out_edges(n, (set_t) 0);
+    for (int src = 0; src < n; ++src) {
+        for (int dst = 0; dst < n; ++dst) {
+            if (src != dst && weights[src][dst] < inf) {
+                out_edges[src] |= static_cast<set_t>(1) << dst;
+            }
+        }
+    }
+    const Binomials bin_coef(n, n);
+
+    std::vector<Layer<T, vertex_t, set_t>> layers;
+    layers.reserve(n + 1);
+    layers.emplace_back();  // no sets of cardinality 0
+    LayerBuilder<T, vertex_t, set_t> first(1, find_path);
+    for (int dst = 0; dst < n; ++dst) {
+        const T cost = end_in_starting_point ? weights[n][dst] : (T) 0;
+        T start_cost;
+        if (sum_below(cost, (T) 0, start_cost)) {
+            first.relax(static_cast<set_t>(1) << dst, (vertex_t) dst,
+                        start_cost, (vertex_t) dst);
+        }
+    }
+    layers.push_back(first.pack());
+    // compared summed over layers, the few states of the last layers
+    // are always a large fraction of their dense states
+    double num_states = layers.back().numStates();
+    double num_dense_states = n;
+
+    for (int cardinality = 1; cardinality < n; ++cardinality) {
+        Layer<T, vertex_t, set_t> &prev_layer = layers[cardinality];
+        LayerBuilder<T, vertex_t, set_t> builder(cardinality + 1, find_path);
+        for (size_t set_idx = 0; set_idx < prev_layer.sets.size(); ++set_idx) {
+            const set_t set = prev_layer.sets[set_idx];
+            uint64_t state = prev_layer.starts[set_idx];
+            for (set_t ends = prev_layer.end_masks[set_idx];
+                 ends;
+                 ends &= ends - 1, ++state
+            ) {
+                const vertex_t src = (vertex_t) __builtin_ctzll(ends);
+                const T cost = prev_layer.costs[state];
+                for (set_t dsts = out_edges[src] & ~set & all_vertices;
+                     dsts;
+                     dsts &= dsts - 1
+                ) {
+                    const vertex_t dst = (vertex_t) __builtin_ctzll(dsts);
+                    T next_cost;
+                    if (sum_below(cost, weights[src][dst], next_cost)) {
+                        builder.relax(set | (static_cast<set_t>(1) << dst),
+                                      dst, next_cost, src);
+                    }
+                }
+            }
+        }
+        std::vector<T>().swap(prev_layer.costs);
+        layers.push_back(builder.pack());
+
+        const Layer<T, vertex_t, set_t> &next_layer = layers.back();
+        const int next_card = cardinality + 1;
+        num_states += next_layer.numStates();
+        num_dense_states += 1. * bin_coef(n, next_card) * next_card;
+        if (num_states > max_layer_fill * num_dense_states) return false;
+        if (!find_path) {
+            // only the last layer is needed without a path
+            std::vector<set_t>().swap(prev_layer.sets);
+            std::vector<set_t>().swap(prev_layer.end_masks);
+            std::vector<uint64_t>().swap(prev_layer.starts);
+        }
+        if (next_layer.sets.empty()) break;
+    }
+
+    // ends of the set of all vertices, closed into start if a cycle
+    const Layer<T, vertex_t, set_t> &last = layers.back();
+    T min_cost = best_cost;
+    vertex_t best_end = (vertex_t) 0;
+    bool is_found = false;
+    if (static_cast<int>(layers.size()) == n + 1 && !last.sets.empty()) {
+        uint64_t state = last.starts[0];
+        for (set_t ends = last.end_masks[0]; ends; ends &= ends - 1, ++state) {
+            const vertex_t end = (vertex_t) __builtin_ctzll(ends);
+            const T closing = end_in_starting_point ? weights[end][n] : (T) 0;
+            if (closing == inf) continue;
+            const double sum = static_cast<double>(last.costs[state])
+                             + static_cast<double>(closing);
+            if (sum < static_cast<double>(min_cost)) {
+                min_cost = last.costs[state] + closing;
+                best_end = end;
+                is_found = true;
+            }
+        }
+    }
+    best_cost = min_cost;
+    if (!find_path) return true;
+    if (!is_found) {
+        solution.clear();
+        return true;
+    }
+
+    solution.resize(end_in_starting_point ? n + 2 : n);
+    vertex_t * const path = solution.data() + end_in_starting_point;
+    set_t set = all_vertices;
+    vertex_t end = best_end;
+    for (int cardinality = n; cardinality >= 1; --cardinality) {
+        path[cardinality - 1] = end;
+        const Layer<T, vertex_t, set_t> &layer = layers[cardinality];
+        const vertex_t prev = layer.prevs[layer.find(set, end)];
+        set ^= static_cast<set_t>(1) << end;
+        end = prev;
+    }
+    if (end_in_starting_point) solution[0] = solution.back() = n;
+    return true;
+}
+
+}  // sparse namespace
+}  // detail namesspace
+
+#endif
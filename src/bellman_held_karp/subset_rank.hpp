@@ -0,0 +1,190 @@
+#ifndef SUBSET_RANK_HPP
+#define SUBSET_RANK_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+namespace detail {
+
+/// @brief Binomial coefficients C(n, k) for n <= max_n, k <= max_k in a
+///        single flat row-major array, C(n, k) = 0 for k > n.
+class Binomials {
+ public:
+
+    using ull = unsigned long long;
+
+    Binomials(const int max_n, int max_k) {
+        if (max_k < 0) max_k = max_n;
+        this->stride = max_k + 1;
+        this->coefs.assign((max_n + 1) * this->stride, 0ULL);
+        for (int n = 0; n <= max_n; ++n) {
+            this->coefs[n * this->stride] = 1ULL;
+            for (int k = 1; k <= std::min(n, max_k); ++k) {
+                this->coefs[n * this->stride + k]
+                    = (*this)(n - 1, k - 1) + (*this)(n - 1, k);
+            }
+        }
+    }
+
+    [[ nodiscard ]] ull operator()(const int n, const int k) const noexcept {
+        return this->coefs[n * this->stride + k];
+    }
+
+ private:
+
+    std::vector<ull> coefs;
+    int stride;
+
+};
+
+/**
+ * @brief Ranks and successor ranks of the set's one-vertex extensions,
+ *        rank(set + dst) = suffix[0] - suffix[i] + C(dst, i + 1) + shifted[i]
+ *        where i is num of set's vertices below dst.
+ */
+struct ExtensionRanks {
+    using ull = unsigned long long;
+
+    uint8_t srcs[64];    // set's vertices ascending
+    ull suffix[65];      // suffix[i] = sum over j >= i of C(srcs[j], j + 1)
+    ull shifted[65];     // shifted[i] = sum over j >= i of C(srcs[j], j + 2)
+};
+
+/**
+ * @brief Colex rank of k-subsets in the combinatorial number system,
+ *        rank(set) = sum of C(v_i, i) over its vertices v_1 < ... < v_k.
+ *        Arbitrary sets are ranked by a lookup per byte of the set in
+ *        tables of byte's partial ranks given num of vertices below it,
+ *        consecutive sets in Gosper's order by updating ExtensionRanks
+ *        only below the highest changed bit, amortized O(1) per set.
+ */
+template<typename set_t>
+class SubsetRanker {
+ public:
+
+    using ull = unsigned long long;
+
+    /// @param max_k - max cardinality of ranked sets
+    SubsetRanker(const int n, const int max_k)
+        : binom(n, max_k + 1), n(n), max_k(max_k)
+    {
+        this->num_bytes = (n + 7) / 8;
+        this->byte_ranks.assign(this->num_bytes * (max_k + 1) * 256, 0ULL);
+        for (int byte_idx = 0; byte_idx < this->num_bytes; ++byte_idx) {
+            for (int below = 0; below <= max_k; ++below) {
+                ull * const row = this->byte_ranks.data()
+                                + (byte_idx * (max_k + 1) + below) * 256;
+                for (int bits = 1; bits < 256; ++bits) {
+                    int idx = below;
+                    ull rank = 0ULL;
+                    for (int b = bits; b && idx < max_k; b &= b - 1) {
+                        const int v = byte_idx * 8 + __builtin_ctz(b);
+                        rank += v < n ? this->binom(v, ++idx) : 0ULL;
+                    }
+                    row[bits] = rank;
+                }
+            }
+        }
+    }
+
+    [[ nodiscard ]] const Binomials & binomials() const noexcept {
+        return this->binom;
+    }
+
+    /// @return rank of the set among sets of its cardinality
+    [[ gnu::hot ]]
+    ull rank(set_t set) const noexcept {
+        ull rank = 0ULL;
+        int below = 0;
+        for (const ull * row = this->byte_ranks.data();
+             set;
+             set >>= 8, row += (this->max_k + 1) * 256
+        ) {
+            const unsigned bits = static_cast<unsigned>(set & 0xFF);
+            rank += row[below * 256 + bits];
+            below += __builtin_popcount(bits);
+        }
+        return rank;
+    }
+
+    /// @return set at given rank among sets of given cardinality
+    set_t unrank(ull rank, const int cardinality) const noexcept {
+        set_t set = (set_t) 0;
+        int v = this->n - 1;
+        for (int k = cardinality; k >= 1; --k, --v) {
+            while (this->binom(v, k) > rank) --v;
+            rank -= this->binom(v, k);
+            set |= static_cast<set_t>(1) << v;
+        }
+        return set;
+    }
+
+    /// @return set at given rank, ranks are filled for it
+    set_t first(ExtensionRanks &ranks, const ull rank,
+                const int cardinality) const noexcept {
+        const set_t set = this->unrank(rank, cardinality);
+        this->refill(ranks, set, set);
+        return set;
+    }
+
+    /// @return next set in Gosper's (colex) order, ranks are updated for it
+    [[ gnu::hot ]]
+    set_t next(ExtensionRanks &ranks, const set_t set) const noexcept {
+        // Gosper's hack:
+        const set_t c = set & -set;
+        const set_t r = set + c;
+        const set_t next = (((r ^ set) >> 2) / c) | r;
+        this->refill(ranks, next, set ^ next);
+        return next;
+    }
+
+    /// @param num_below - num of set's vertices below dst
+    /// @return rank of the set with added dst
+    [[ gnu::hot, gnu::always_inline ]]
+    ull rankWith(const ExtensionRanks &ranks, const int dst,
+                 const int num_below) const noexcept {
+        return ranks.suffix[0] - ranks.suffix[num_below]
+             + this->binom(dst, num_below + 1) + ranks.shifted[num_below];
+    }
+
+ private:
+
+    Binomials binom;
+    std::vector<ull> byte_ranks;  // [byte_idx][num below byte][byte]
+    int n;
+    int max_k;
+    int num_bytes;
+
+    /// @brief Recomputes ranks of vertices up to the highest changed one,
+    ///        vertices above it keep both their values and indices.
+    [[ gnu::hot, gnu::always_inline ]]
+    void refill(ExtensionRanks &ranks, const set_t set,
+                const set_t changed) const noexcept {
+        const int highest = 63 - __builtin_clzll(
+            static_cast<ull>(changed) | 1ULL
+        );
+        const ull low_mask = highest == 63 ? ~0ULL
+                           : (2ULL << highest) - 1ULL;
+        const ull low = static_cast<ull>(set) & low_mask;
+        const int num_low = __builtin_popcountll(low);
+        if (static_cast<ull>(set) == low) {
+            ranks.suffix[num_low] = 0ULL;
+            ranks.shifted[num_low] = 0ULL;
+        }
+        int i = 0;
+        for (ull bits = low; bits; bits &= bits - 1, ++i) {
+            ranks.srcs[i] = (uint8_t) __builtin_ctzll(bits);
+        }
+        for (i = num_low - 1; i >= 0; --i) {
+            const int v = ranks.srcs[i];
+            ranks.suffix[i] = ranks.suffix[i + 1] + this->binom(v, i + 1);
+            ranks.shifted[i] = ranks.shifted[i + 1] + this->binom(v, i + 2);
+        }
+    }
+
+};
+
+}  // detail namesspace
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef UPPER_BOUND_HPP
+#define UPPER_BOUND_HPP
+
+#include <vector>
+#include <string>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <type_traits>
+#include "../k_opt/history.hpp"
+#include "../k_opt/vertex.hpp"
+#include "../k_opt/factories.hpp"
+#include "half_float.hpp"
+
+namespace detail {
+
+/// @return Cost of the tour in weights, max of cost_t if it does not fit.
+template<typename cost_t>
+cost_t calcTourCost(
+    const std::vector<std::vector<cost_t>> &weights,
+    const std::vector<int> &tour,
+    const bool search_for_cycle
+) {
+    using sum_t = std::conditional_t<std::is_floating_point_v<cost_t>,
+                                     double, long double>;
+    const int n = tour.size();
+    sum_t cost = search_for_cycle && n > 0
+               ? static_cast<sum_t>(weights[tour.back()][tour[0]])
+               : (sum_t) 0;
+    for (int i = 1; i < n; ++i) {
+        cost += static_cast<sum_t>(weights[tour[i - 1]][tour[i]]);
+    }
+    if (cost >= static_cast<sum_t>(std::numeric_limits<cost_t>::max())) {
+        return std::numeric_limits<cost_t>::max();
+    }
+    return static_cast<cost_t>(cost);
+}
+
+/// @brief Runs k-opt local search until no improving cut is left,
+///        asymmetric weights are searched symmetrized since the cuts
+///        reverse segments, then the cheaper direction is kept.
+/// @return Visiting order of all vertices, for a path the endpoints are
+///         first and last.
+template<typename distance_t>
+std::vector<int> findHeuristicTour(
+    const std::vector<std::vector<distance_t>> &distances,
+    const bool search_for_cycle,
+    const bool is_symmetric,
+    const unsigned int seed,
+    const std::string &selection_name = "funky",
+    const std::string &cut_name = "3_opt"
+) {
+    using vertex_t = k_opt::Vertex<int>;
+    const int n = distances.size();
+    std::vector<int> tour(n);
+    std::iota(tour.begin(), tour.end(), 0);
+    if (n <= 3) return tour;  // nothing to cut
+
+    k_opt::History<distance_t> history("");
+    history.stop();
+    const auto algo = k_opt::factories::createAlgo<distance_t, vertex_t>(
+        selection_name, cut_name, seed
+    );
+    std::vector<std::vector<distance_t>> symmetrized;
+    if (!is_symmetric) {
+        symmetrized = distances;
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < i; ++j) {
+                symmetrized[i][j] = symmetrized[j][i]
+                    = (distances[i][j] + distances[j][i]) / 2;
+            }
+        }
+    }
+    std::vector<vertex_t> path_buffer;
+    typename vertex_t::traits::node_ptr path;
+    algo->search(path, path_buffer, is_symmetric ? distances : symmetrized,
+                 !search_for_cycle, history, seed);
+    auto cur = path;
+    for (int i = 0; i < n; ++i, cur = vertex_t::traits::get_next(cur)) {
+        tour[i] = vertex_t::v(cur)->id;
+    }
+    if (!is_symmetric) {
+        std::vector<int> reversed(tour.rbegin(), tour.rend());
+        if ( calcTourCost(distances, reversed, search_for_cycle)
+           < calcTourCost(distances, tour, search_for_cycle)
+        ) {
+            tour = std::move(reversed);
+        }
+    }
+    return tour;
+}
+
+/// @return Smallest bound strictly above cost, so that bellmanHeldKarp
+///         still finds a path of the same cost, accounts for rounding
+///         in float sums and of costs stored as stored_t.
+template<typename cost_t, typename stored_t = cost_t>
+cost_t boundAbove(const cost_t cost, const int num_edges) {
+    constexpr cost_t inf = std::numeric_limits<cost_t>::max();
+    if (cost >= inf) return inf;
+    if constexpr (std::is_floating_point_v<cost_t>) {
+        const double rel_err = 4. * (num_edges + 1)
+                             * storageEpsilon<stored_t>();
+        const double bound = static_cast<double>(cost)
+                           + std::abs(static_cast<double>(cost)) * rel_err
+                           + std::numeric_limits<cost_t>::min();
+        return bound >= static_cast<double>(inf) ? inf
+                                                 : static_cast<cost_t>(bound);
+    } else {
+        return cost + 1;
+    }
+}
+
+}  // detail namesspace
+
+#endif
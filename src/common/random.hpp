@@ -24,11 +24,14 @@ boost::random::mt19937 initPSRNG(unsigned int seed=0U, const int verbose=0) {
     return mt;
 }
 
-template<typename T>
+template<
+    typename T,
+    typename swap_t = decltype([] (T &x, T &y) { std::swap(x, y); })
+>
 void permuteRandomly(
     std::vector<T> &perm,
     boost::random::mt19937 &psrng,
-    auto &&swap = [] (T &x, T &y) { std::swap(x, y); }
+    swap_t &&swap = {}
 ) {
     for (int i = perm.size() - 1; i > 0; --i) {
         boost::random::uniform_int_distribution<
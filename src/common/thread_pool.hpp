@@ -0,0 +1,137 @@
+#ifndef TSP_COMMON_THREAD_POOL_HPP
+#define TSP_COMMON_THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+namespace threading {
+
+/// @return num_threads if positive, else num of hardware threads
+inline int resolveNumThreads(const int num_threads) {
+    if (num_threads > 0) return num_threads;
+    const int hw = static_cast<int>(std::thread::hardware_concurrency());
+    return hw > 0 ? hw : 1;
+}
+
+/**
+ * @brief Fixed set of workers executing blocking parallel-for jobs.
+ *        The calling thread participates as worker 0, so a pool of
+ *        size 1 spawns no threads and runs everything inline.
+ */
+class ThreadPool {
+ public:
+
+    explicit ThreadPool(const int num_threads = 0)
+        : num_workers(resolveNumThreads(num_threads))
+    {
+        this->workers.reserve(this->num_workers - 1);
+        for (int i = 1; i < this->num_workers; ++i) {
+            this->workers.emplace_back([this, i] () { this->workerLoop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(this->mtx);
+            this->is_stopping = true;
+        }
+        this->job_cv.notify_all();
+        for (auto &worker : this->workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator=(const ThreadPool &) = delete;
+
+    [[ nodiscard ]] int size() const noexcept { return this->num_workers; }
+
+    /**
+     * @brief Calls task(task_idx, worker_idx) for every task_idx in
+     *        [0, num_tasks), tasks are handed out dynamically.
+     *        Blocks until all tasks are done, rethrows first exception.
+     */
+    template<typename task_t>
+    void parallelFor(const unsigned long long num_tasks, task_t &&task) {
+        if (num_tasks == 0ULL) return;
+        if (this->num_workers == 1 || num_tasks == 1ULL) {
+            for (unsigned long long i = 0ULL; i < num_tasks; ++i) task(i, 0);
+            return;
+        }
+        const std::function<void (unsigned long long, int)> job = task;
+        {
+            std::lock_guard<std::mutex> lock(this->mtx);
+            this->cur_job = &job;
+            this->num_tasks = num_tasks;
+            this->next_task.store(0ULL, std::memory_order_relaxed);
+            this->num_busy = this->num_workers - 1;
+            this->err = nullptr;
+            ++this->generation;
+        }
+        this->job_cv.notify_all();
+        this->drainTasks(0);
+        std::unique_lock<std::mutex> lock(this->mtx);
+        this->done_cv.wait(lock, [this] () { return this->num_busy == 0; });
+        this->cur_job = nullptr;
+        if (this->err) std::rethrow_exception(this->err);
+    }
+
+ private:
+
+    const int num_workers;
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable job_cv;
+    std::condition_variable done_cv;
+    const std::function<void (unsigned long long, int)> *cur_job = nullptr;
+    unsigned long long num_tasks = 0ULL;
+    std::atomic<unsigned long long> next_task { 0ULL };
+    unsigned long long generation = 0ULL;
+    int num_busy = 0;
+    bool is_stopping = false;
+    std::exception_ptr err = nullptr;
+
+    void drainTasks(const int worker_idx) {
+        for (unsigned long long i = this->next_task.fetch_add(1ULL);
+             i < this->num_tasks;
+             i = this->next_task.fetch_add(1ULL)
+        ) {
+            try {
+                (*this->cur_job)(i, worker_idx);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(this->mtx);
+                if (!this->err) this->err = std::current_exception();
+                // skip remaining tasks
+                this->next_task.store(this->num_tasks);
+            }
+        }
+    }
+
+    void workerLoop(const int worker_idx) {
+        unsigned long long seen_generation = 0ULL;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(this->mtx);
+                this->job_cv.wait(lock, [&] () {
+                    return this->is_stopping
+                        || this->generation != seen_generation;
+                });
+                if (this->is_stopping) return;
+                seen_generation = this->generation;
+            }
+            this->drainTasks(worker_idx);
+            {
+                std::lock_guard<std::mutex> lock(this->mtx);
+                if (--this->num_busy == 0) this->done_cv.notify_one();
+            }
+        }
+    }
+
+};
+
+}  // namespace threading
+
+#endif
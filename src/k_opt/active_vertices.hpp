@@ -0,0 +1,151 @@
+#ifndef TSP_K_OPT_ACTIVE_VERTICES_HPP
+#define TSP_K_OPT_ACTIVE_VERTICES_HPP
+
+#include <vector>
+#include <utility>
+#include "vertex_concept.hpp"
+#include "path_algos.hpp"
+#include "heuristic.hpp"
+#include "candidates.hpp"
+
+namespace k_opt {
+namespace detail {
+
+/// @brief Same segments and callback as loopSegmentsDynamic/Static, but
+///        only tuples with a cut on either edge of the anchor, O(n^(k-1)).
+template<int K, IntrusiveVertex vertex_t, typename callback_t>
+[[ gnu::hot ]]
+inline bool loopAnchoredSegments(
+    typename vertex_t::traits::node_ptr anchor,
+    const int k,
+    const int n,
+    std::pair<
+        typename vertex_t::traits::node_ptr,
+        typename vertex_t::traits::node_ptr
+    > * __restrict const segs,
+    callback_t &&cb
+) noexcept {
+    const auto other = vertex_t::traits::get_previous(anchor);
+    const typename vertex_t::traits::node_ptr nexts[2] = {
+        k_opt::path_algos::get_neighbour<vertex_t>(anchor, other),
+        other  // walking the other way cuts the other edge
+    };
+    for (const auto next : nexts) {
+        segs[0].second = anchor;
+        if constexpr (K == -1) {
+            if (loopSegmentsDynamic<vertex_t>(
+                anchor, next, 1, 1, k, n, segs, cb
+            )) [[ unlikely ]] return true;
+        } else {
+            if (loopSegmentsStatic<K, 1, vertex_t>(
+                anchor, next, 1, n, segs, cb
+            )) [[ unlikely ]] return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Don't-look bits, a FIFO queue of vertices whose edges may still
+ *        be cut with a gain. Holds every vertex at first, then the anchor
+ *        and endpoints of all cut edges of each applied move, so a local
+ *        optimum is reached by O(n + moves * k) anchored loops instead of
+ *        a scan of all cuts after each move.
+ *        Empty and unused if off or k < 2, a single cut has no endpoints
+ *        of the changed edges among its segments.
+ */
+template<IntrusiveVertex vertex_t>
+class ActiveVertices {
+ public:
+
+    using node_ptr = typename vertex_t::traits::node_ptr;
+    using seg_t = std::pair<node_ptr, node_ptr>;
+
+    ActiveVertices(
+        node_ptr path,
+        const int n,
+        const int k,
+        const bool is_on
+    ) : is_used(is_on && k >= 2) {
+        if (!this->is_used) return;
+        this->nodes.resize(n);
+        this->is_active.resize(n, false);
+        this->queue.resize(n);
+        auto prev = vertex_t::traits::get_previous(path);
+        auto cur = path;
+        for (int i = 0; i < n; ++i) {
+            this->nodes[vertex_t::v(cur)->id] = cur;
+            this->push(vertex_t::v(cur)->id);
+            auto next = k_opt::path_algos::get_neighbour<vertex_t>(cur, prev);
+            prev = cur;
+            cur = next;
+        }
+    }
+
+    [[ nodiscard ]] bool isUsed() const noexcept { return this->is_used; }
+
+    /**
+     * @brief Loops cuts anchored at active vertices, popped in turn, until
+     *        callback returns true, which has to be after it changes the
+     *        tour. Then re-activates the vertices the move touched.
+     * @return false once no vertex is active.
+     */
+    template<int K, typename callback_t>
+    [[ gnu::hot ]]
+    bool loop(
+        CandidateSegments<vertex_t> &candidates,
+        const int k,
+        const int n,
+        seg_t * __restrict const segs,
+        callback_t &&cb
+    ) noexcept {
+        while (this->num_queued > 0) {
+            const int id = this->pop();
+            const bool is_changed = candidates.isUsed()
+                ? candidates.loopAnchored(this->nodes[id], k, n, segs, cb)
+                : loopAnchoredSegments<K, vertex_t>(
+                    this->nodes[id], k, n, segs, cb
+                );
+            if (is_changed) [[ unlikely ]] {
+                // reordered segments keep the same endpoints
+                this->push(id);
+                for (int i = 0; i < k; ++i) {
+                    this->push(vertex_t::v(segs[i].first)->id);
+                    this->push(vertex_t::v(segs[i].second)->id);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+ private:
+
+    bool is_used;
+    std::vector<node_ptr> nodes;  // by id
+    std::vector<char> is_active;  // by id, the negated don't-look bits
+    std::vector<int> queue;  // ring of ids, each at most once
+    int head = 0;
+    int num_queued = 0;
+
+    void push(const int id) noexcept {
+        if (this->is_active[id]) return;
+        this->is_active[id] = true;
+        const int n = this->queue.size();
+        this->queue[(this->head + this->num_queued) % n] = id;
+        ++this->num_queued;
+    }
+
+    int pop() noexcept {
+        const int id = this->queue[this->head];
+        this->head = (this->head + 1) % static_cast<int>(this->queue.size());
+        --this->num_queued;
+        this->is_active[id] = false;
+        return id;
+    }
+};
+
+}  // namespace detail
+}  // namespace k_opt
+
+#endif
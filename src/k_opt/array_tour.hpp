@@ -0,0 +1,157 @@
+#ifndef TSP_K_OPT_ARRAY_TOUR_HPP
+#define TSP_K_OPT_ARRAY_TOUR_HPP
+
+#include <vector>
+#include <algorithm>
+#include "vertex_concept.hpp"
+#include "path_algos.hpp"
+
+namespace k_opt {
+
+/**
+ * @brief Order and position arrays of an intrusive tour, so the vertex at
+ *        a position, the position of a vertex, next, prev and between are
+ *        O(1) instead of walks. Cuts keep relinking the nodes themselves,
+ *        after a move the arrays follow its new links over all but the
+ *        longest of its segments, which stays in place, O(n - longest)
+ *        instead of O(n), e.g. the shorter side of a 2-opt reversal.
+ */
+template<IntrusiveVertex vertex_t>
+class ArrayTour {
+ public:
+
+    using node_ptr = typename vertex_t::traits::node_ptr;
+
+    ArrayTour() = default;
+
+    explicit ArrayTour(const int n) : order(2 * n), pos(n) { }
+
+    void resize(const int n) {
+        this->order.resize(2 * n);
+        this->pos.resize(n);
+    }
+
+    [[ nodiscard ]] int size() const noexcept {
+        return static_cast<int>(this->pos.size());
+    }
+
+    /// @brief Walks the whole tour from start, which gets position 0,
+    ///        away from its previous node.
+    void fill(node_ptr start) noexcept {
+        auto prev = vertex_t::traits::get_previous(start);
+        auto cur = start;
+        for (int i = 0, n = this->size(); i < n; ++i) {
+            this->order[i] = this->order[i + n] = cur;
+            this->pos[vertex_t::v(cur)->id] = i;
+            auto next = k_opt::path_algos::get_neighbour<vertex_t>(cur, prev);
+            prev = cur;
+            cur = next;
+        }
+    }
+
+    /// @param i Position in [0, 2n), order is stored twice so offsets
+    ///          need no modulo.
+    [[ gnu::always_inline ]]
+    node_ptr at(const int i) const noexcept { return this->order[i]; }
+
+    /// @return Nodes from position i on, n of them are contiguous.
+    [[ gnu::always_inline ]]
+    const node_ptr* from(const int i) const noexcept {
+        return this->order.data() + i;
+    }
+
+    [[ gnu::always_inline ]]
+    int posOf(typename vertex_t::traits::const_node_ptr v) const noexcept {
+        return this->pos[vertex_t::v(v)->id];
+    }
+
+    [[ gnu::always_inline ]]
+    int posOfId(const int id) const noexcept { return this->pos[id]; }
+
+    [[ gnu::always_inline ]]
+    node_ptr next(typename vertex_t::traits::const_node_ptr v)
+        const noexcept
+    {
+        return this->order[this->posOf(v) + 1];
+    }
+
+    [[ gnu::always_inline ]]
+    node_ptr prev(typename vertex_t::traits::const_node_ptr v)
+        const noexcept
+    {
+        const int p = this->posOf(v);
+        return this->order[p > 0 ? p - 1 : this->size() - 1];
+    }
+
+    /// @return Whether b is met going from a to c forwards, inclusive.
+    [[ nodiscard ]] bool between(
+        typename vertex_t::traits::const_node_ptr a,
+        typename vertex_t::traits::const_node_ptr b,
+        typename vertex_t::traits::const_node_ptr c
+    ) const noexcept {
+        const int pa = this->posOf(a), pb = this->posOf(b);
+        const int pc = this->posOf(c);
+        return pa <= pc ? pa <= pb && pb <= pc
+                        : pa <= pb || pb <= pc;
+    }
+
+    /// @return Position after which the edge of adjacent a and b is.
+    [[ nodiscard ]] int cutPos(
+        typename vertex_t::traits::const_node_ptr a,
+        typename vertex_t::traits::const_node_ptr b
+    ) const noexcept {
+        const int pa = this->posOf(a), pb = this->posOf(b);
+        return pb == pa + 1 || (pb == 0 && pa == this->size() - 1) ? pa : pb;
+    }
+
+    /**
+     * @brief Follows a move just applied to the linked list.
+     * @param cuts Distinct positions in [0, 2n) after which the move cut
+     *             edges, taken before it, in any order. A single cut may have
+     *             changed anything, as does the hk_window one, so then
+     *             and for over 16 cuts the whole tour is walked again.
+     */
+    void relink(const int * __restrict const cuts, const int k) noexcept {
+        const int n = this->size();
+        if (k < 2 || k > 16) [[ unlikely ]] {
+            this->fill(this->order[0]);
+            return;
+        }
+        int sorted_cuts[16];
+        for (int i = 0; i < k; ++i) {
+            sorted_cuts[i] = cuts[i] < n ? cuts[i] : cuts[i] - n;
+        }
+        std::sort(sorted_cuts, sorted_cuts + k);
+        // segment i ends at sorted_cuts[i], the one ending first wraps
+        int kept_end = sorted_cuts[0];
+        int kept_len = sorted_cuts[0] + n - sorted_cuts[k - 1];
+        for (int i = 1; i < k; ++i) {
+            const int len = sorted_cuts[i] - sorted_cuts[i - 1];
+            if (len > kept_len) {
+                kept_end = sorted_cuts[i];
+                kept_len = len;
+            }
+        }
+        auto cur = this->order[kept_end];
+        auto prev = kept_len > 1  // else either way is the same tour
+                  ? this->order[kept_end > 0 ? kept_end - 1 : n - 1]
+                  : vertex_t::traits::get_previous(cur);
+        for (int i = 1, p = kept_end + 1; i <= n - kept_len; ++i, ++p) {
+            if (p == n) p = 0;
+            auto next = k_opt::path_algos::get_neighbour<vertex_t>(cur, prev);
+            prev = cur;
+            cur = next;
+            this->order[p] = this->order[p + n] = cur;
+            this->pos[vertex_t::v(cur)->id] = p;
+        }
+    }
+
+ private:
+
+    std::vector<node_ptr> order;  // twice
+    std::vector<int> pos;  // by id
+};
+
+}  // namespace k_opt
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef TSP_K_OPT_CANDIDATES_HPP
+#define TSP_K_OPT_CANDIDATES_HPP
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include "vertex_concept.hpp"
+#include "path_algos.hpp"
+#include "array_tour.hpp"
+
+namespace k_opt {
+namespace detail {
+
+/// @return [v * m + i] is the i-th nearest vertex to v by the cheaper
+///         direction of their edge, m is capped at n - 1.
+template<typename cost_t>
+std::vector<int> findCandidates(
+    const cost_t * __restrict const weights,
+    const int n,
+    int &m
+) {
+    m = std::max(0, std::min(m, n - 1));
+    std::vector<int> candidates(static_cast<size_t>(n) * m);
+    std::vector<int> others(n);
+    for (int v = 0; v < n; ++v) {
+        const auto dist = [&] (const int u) {
+            return std::min(weights[v * n + u], weights[u * n + v]);
+        };
+        std::iota(others.begin(), others.end(), 0);
+        std::swap(others[v], others.back());
+        std::partial_sort(
+            others.begin(), others.begin() + m, others.end() - 1,
+            [&] (const int x, const int y) { return dist(x) < dist(y); }
+        );
+        std::copy_n(others.begin(), m, candidates.begin() + v * m);
+    }
+    return candidates;
+}
+
+/**
+ * @brief Candidate lists of an instance with buffers of their loops,
+ *        empty and unused if m <= 0 or k is over 16.
+ *        Loops give the same segments and callback as loopSegmentsDynamic,
+ *        but only cuts chained by candidates: the first cut is after a
+ *        vertex of the tour, each next one is before or after a candidate
+ *        of the vertex before the previous cut, so every tuple has a new
+ *        edge between candidates for any of them to reconnect. Cuts are
+ *        sorted into tour order and repeated tuples are not skipped.
+ *        O(n * (2m)^(k - 1)) tuples instead of O(n^k).
+ */
+template<IntrusiveVertex vertex_t>
+class CandidateSegments {
+ public:
+
+    using node_ptr = typename vertex_t::traits::node_ptr;
+    using seg_t = std::pair<node_ptr, node_ptr>;
+
+    template<typename cost_t>
+    CandidateSegments(
+        const cost_t * __restrict const weights,
+        const int n,
+        const int k,
+        const int m
+    ) : m(k <= 16 ? m : 0) {
+        if (this->m <= 0) return;
+        this->candidates = findCandidates(weights, n, this->m);
+        this->tour.resize(n);
+    }
+
+    [[ nodiscard ]] bool isUsed() const noexcept { return this->m > 0; }
+
+    /// @brief First cut after every vertex from start on, callback has to
+    ///        return true after it changes the tour, the order then
+    ///        follows the move, see ArrayTour::relink.
+    template<typename callback_t>
+    [[ gnu::hot ]]
+    bool loop(
+        node_ptr start,
+        const int k,
+        const int n,
+        seg_t * __restrict const segs,
+        callback_t &&cb
+    ) noexcept {
+        this->fillIfStale(start);
+        const int start_pos = this->tour.posOf(start);
+        for (int i = 0; i < n; ++i) {
+            this->cuts[0] = start_pos + i < n ? start_pos + i
+                                              : start_pos + i - n;
+            if (this->chain(1, k, n, segs, cb)) [[ unlikely ]] return true;
+        }
+        return false;
+    }
+
+    /// @brief First cut on either edge of the anchor, same as loop else.
+    template<typename callback_t>
+    [[ gnu::hot ]]
+    bool loopAnchored(
+        node_ptr anchor,
+        const int k,
+        const int n,
+        seg_t * __restrict const segs,
+        callback_t &&cb
+    ) noexcept {
+        this->fillIfStale(anchor);
+        const int anchor_pos = this->tour.posOf(anchor);
+        this->cuts[0] = anchor_pos;
+        if (this->chain(1, k, n, segs, cb)) [[ unlikely ]] return true;
+        this->cuts[0] = anchor_pos > 0 ? anchor_pos - 1 : n - 1;
+        return this->chain(1, k, n, segs, cb);
+    }
+
+    /// @brief To be called once the tour changed outside of a callback.
+    void markChanged() noexcept { this->is_order_stale = true; }
+
+ private:
+
+    int m;
+    bool is_order_stale = true;
+    std::vector<int> candidates;  // [v * m + i], see findCandidates
+    ArrayTour<vertex_t> tour;
+    int cuts[16];  // in order of choice, after the vertex at that pos
+    int sorted_cuts[16];
+
+    void fillIfStale(node_ptr start) noexcept {
+        if (!this->is_order_stale) return;
+        this->tour.fill(start);
+        this->is_order_stale = false;
+    }
+
+    template<typename callback_t>
+    [[ gnu::hot ]]
+    bool process(
+        const int k,
+        seg_t * __restrict const segs,
+        callback_t &&cb
+    ) noexcept {
+        std::copy_n(this->cuts, k, this->sorted_cuts);
+        std::sort(this->sorted_cuts, this->sorted_cuts + k);
+        for (int i = 1; i < k; ++i) {
+            if (this->sorted_cuts[i] == this->sorted_cuts[i - 1]) {
+                return false;
+            }
+        }
+        segs[0].first = this->tour.at(this->sorted_cuts[k - 1] + 1);
+        segs[0].second = this->tour.at(this->sorted_cuts[0]);
+        for (int i = 1; i < k; ++i) {
+            segs[i].first = this->tour.at(this->sorted_cuts[i - 1] + 1);
+            segs[i].second = this->tour.at(this->sorted_cuts[i]);
+        }
+        if (!cb()) [[ likely ]] return false;
+        this->tour.relink(this->sorted_cuts, k);
+        return true;
+    }
+
+    template<typename callback_t>
+    [[ gnu::hot ]]
+    bool chain(
+        const int depth,
+        const int k,
+        const int n,
+        seg_t * __restrict const segs,
+        callback_t &&cb
+    ) noexcept {
+        if (depth == k) return this->process(k, segs, cb);
+        const auto at_prev_cut = this->tour.at(this->cuts[depth - 1]);
+        const int * const cands = this->candidates.data()
+                                + vertex_t::v(at_prev_cut)->id * this->m;
+        for (int i = 0; i < this->m; ++i) {
+            const int cand_pos = this->tour.posOfId(cands[i]);
+            // cut before the candidate, then after it
+            this->cuts[depth] = cand_pos > 0 ? cand_pos - 1 : n - 1;
+            if (this->chain(depth + 1, k, n, segs, cb)) [[ unlikely ]] {
+                return true;
+            }
+            this->cuts[depth] = cand_pos;
+            if (this->chain(depth + 1, k, n, segs, cb)) [[ unlikely ]] {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}  // namespace detail
+}  // namespace k_opt
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef TSP_HK_WINDOW_CUT_HPP
+#define TSP_HK_WINDOW_CUT_HPP
+
+#include <vector>
+#include <utility>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+#include "vertex_concept.hpp"
+#include "path_algos.hpp"
+
+namespace k_opt {
+
+/**
+ * @brief Implements k_opt::CutStrategy concept with a single cut, the
+ *        edge into a window of consecutive vertices, whose order between
+ *        the fixed vertices before and after it is re-optimized exactly
+ *        by Held-Karp over subsets of the window.
+ *        Has to be run with k = 1 and dynamic K.
+ *        DP tables are allocated once for the max window and reused.
+ *        Best improving window since the last applied one is kept, so
+ *        both first better and best cut heuristics apply the right one.
+ */
+template<typename cost_t, IntrusiveVertex vertex_t>
+class CutHKWindow {
+    static_assert(std::is_arithmetic_v<cost_t>, "cost_t must be arithmetic");
+
+    using node_ptr = typename vertex_t::traits::node_ptr;
+    using seg_t = std::pair<node_ptr, node_ptr>;
+
+ public:
+
+    static constexpr int NUM_CUTS = -1;
+    static constexpr int MAX_WINDOW_SIZE = 16;
+
+    explicit CutHKWindow(const int window_size = 12)
+        : window_size(window_size)
+    {
+        if (window_size < 2 || window_size > MAX_WINDOW_SIZE) {
+            throw std::invalid_argument(
+                "Window size must be in [2, "
+              + std::to_string(MAX_WINDOW_SIZE) + "]."
+            );
+        }
+        this->dp.resize((1ULL << window_size) * window_size);
+        this->prevs.resize(this->dp.size());
+        this->local_weights.resize(window_size * window_size);
+        this->from_before.resize(window_size);
+        this->to_after.resize(window_size);
+        this->window.resize(window_size);
+        this->pending_order.resize(window_size);
+    }
+
+    ~CutHKWindow() = default;
+
+    template<bool can_modify_segs>
+    [[ gnu::hot ]]
+    inline int selectCut(
+        const int n,
+        const seg_t * __restrict const segs,
+        cost_t &change,
+        const cost_t * __restrict const weights,
+        int &perm_idx,
+        [[ maybe_unused ]] const seg_t * __restrict const
+    ) const noexcept;
+
+    /// @brief Applies the pending window if it starts at segs[0].
+    inline void applyCut(
+        const seg_t * __restrict const segs,
+        [[ maybe_unused ]] const int move_ord = 0,
+        [[ maybe_unused ]] const int swap_mask = -1,
+        [[ maybe_unused ]] const seg_t * __restrict const orig_segs = nullptr
+    ) const noexcept;
+
+    [[ nodiscard ]] int getWindowSize() const noexcept {
+        return this->window_size;
+    }
+
+ private:
+
+    int window_size;
+    mutable std::vector<cost_t> dp;  // [set][last in set]
+    mutable std::vector<uint8_t> prevs;  // [set][last in set]
+    mutable std::vector<cost_t> local_weights;  // [from][to]
+    mutable std::vector<cost_t> from_before;
+    mutable std::vector<cost_t> to_after;
+    mutable std::vector<node_ptr> window;
+
+    // pending improvement, best since the last applied one
+    mutable cost_t pending_change = (cost_t) 0;
+    mutable seg_t pending_cut = { nullptr, nullptr };
+    mutable node_ptr pending_last = nullptr;  // before reordering
+    mutable node_ptr pending_after = nullptr;
+    mutable int pending_size = 0;
+    mutable std::vector<node_ptr> pending_order;
+
+    /// @return min cost of the path through all of window's
+    ///         vertices between the fixed ones, its order in order
+    cost_t solveWindow(const int size, node_ptr * __restrict const order)
+        const noexcept;
+};
+
+
+template<typename cost_t, IntrusiveVertex vertex_t>
+template<bool can_modify_segs>
+int CutHKWindow<cost_t, vertex_t>::selectCut(
+    const int n,
+    const seg_t * __restrict const segs,
+    cost_t &change,
+    const cost_t * __restrict const weights,
+    int &perm_idx,
+    [[ maybe_unused ]] const seg_t * __restrict const
+) const noexcept {
+    // fixed vertices before and after the window must differ
+    const int size = std::min(this->window_size, n - 2);
+    change = (cost_t) 0;
+    if (size < 2) return 0;
+
+    node_ptr prev = segs[0].second;
+    node_ptr cur = segs[0].first;
+    const auto before = vertex_t::v(prev)->id;
+    cost_t cur_cost = (cost_t) 0;
+    auto last = before;
+    for (int i = 0; i < size; ++i) {
+        this->window[i] = cur;
+        const auto id = vertex_t::v(cur)->id;
+        cur_cost += weights[last * n + id];
+        last = id;
+        node_ptr next = path_algos::get_neighbour<vertex_t>(cur, prev);
+        prev = cur;
+        cur = next;
+    }
+    const auto after = vertex_t::v(cur)->id;
+    cur_cost += weights[last * n + after];
+
+    for (int i = 0; i < size; ++i) {
+        const auto src = vertex_t::v(this->window[i])->id;
+        this->from_before[i] = weights[before * n + src];
+        this->to_after[i] = weights[src * n + after];
+        for (int j = 0; j < size; ++j) {
+            const auto dst = vertex_t::v(this->window[j])->id;
+            this->local_weights[i * size + j] = weights[src * n + dst];
+        }
+    }
+
+    change = cur_cost;
+    node_ptr order[MAX_WINDOW_SIZE];
+    const cost_t best_cost = this->solveWindow(size, order);
+    if (best_cost < cur_cost) {
+        change = best_cost - cur_cost;
+        perm_idx = 0;
+        if (this->pending_size == 0 || change < this->pending_change) {
+            this->pending_change = change;
+            this->pending_cut = segs[0];
+            this->pending_last = this->window[size - 1];
+            this->pending_after = cur;
+            this->pending_size = size;
+            std::copy_n(order, size, this->pending_order.data());
+        }
+    }
+    return 0;
+}
+
+template<typename cost_t, IntrusiveVertex vertex_t>
+cost_t CutHKWindow<cost_t, vertex_t>::solveWindow(
+    const int size,
+    node_ptr * __restrict const order
+) const noexcept {
+    cost_t * __restrict const dp = this->dp.data();
+    uint8_t * __restrict const prevs = this->prevs.data();
+    const cost_t * __restrict const w = this->local_weights.data();
+
+    for (int v = 0; v < size; ++v) {
+        dp[(1U << v) * size + v] = this->from_before[v];
+    }
+    // subsets precede their supersets in numerical order
+    const unsigned full = (1U << size) - 1U;
+    for (unsigned set = 3U; set <= full; ++set) {
+        if ((set & (set - 1U)) == 0U) continue;  // single vertex
+        for (unsigned dst_bits = set; dst_bits; dst_bits &= dst_bits - 1U) {
+            const int dst = __builtin_ctz(dst_bits);
+            const unsigned prev_set = set ^ (1U << dst);
+            const cost_t * __restrict const prev_costs = dp + prev_set * size;
+            cost_t best = std::numeric_limits<cost_t>::max();
+            int best_src = 0;
+            for (unsigned src_bits = prev_set;
+                 src_bits;
+                 src_bits &= src_bits - 1U
+            ) {
+                const int src = __builtin_ctz(src_bits);
+                const cost_t cost = prev_costs[src] + w[src * size + dst];
+                if (cost < best) {
+                    best = cost;
+                    best_src = src;
+                }
+            }
+            dp[set * size + dst] = best;
+            prevs[set * size + dst] = (uint8_t) best_src;
+        }
+    }
+
+    cost_t best = std::numeric_limits<cost_t>::max();
+    int last = 0;
+    for (int v = 0; v < size; ++v) {
+        const cost_t cost = dp[full * size + v] + this->to_after[v];
+        if (cost < best) {
+            best = cost;
+            last = v;
+        }
+    }
+    unsigned set = full;
+    for (int i = size - 1; i >= 0; --i) {
+        order[i] = this->window[last];
+        const int prev = prevs[set * size + last];
+        set ^= 1U << last;
+        last = prev;
+    }
+    return best;
+}
+
+template<typename cost_t, IntrusiveVertex v_t>
+void CutHKWindow<cost_t, v_t>::applyCut(
+    const seg_t * __restrict const segs,
+    [[ maybe_unused ]] const int,
+    [[ maybe_unused ]] const int,
+    [[ maybe_unused ]] const seg_t * __restrict const
+) const noexcept {
+    if (this->pending_size == 0 || segs[0] != this->pending_cut) return;
+    using t = typename v_t::traits;
+    const int size = this->pending_size;
+    const node_ptr before = this->pending_cut.second;
+    const node_ptr after = this->pending_after;
+    node_ptr * __restrict const order = this->pending_order.data();
+
+    path_algos::set_neighbour<v_t, true>(before, this->pending_cut.first,
+                                         order[0]);
+    path_algos::set_neighbour<v_t, false>(after, this->pending_last,
+                                          order[size - 1]);
+    for (int i = 0; i < size; ++i) {
+        t::set_previous(order[i], i == 0 ? before : order[i - 1]);
+        t::set_next(order[i], i == size - 1 ? after : order[i + 1]);
+    }
+    this->pending_size = 0;
+}
+
+}  // namespace k_opt
+
+#endif
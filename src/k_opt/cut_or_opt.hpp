@@ -0,0 +1,275 @@
+#ifndef TSP_OR_OPT_CUT_HPP
+#define TSP_OR_OPT_CUT_HPP
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "vertex_concept.hpp"
+#include "path_algos.hpp"
+#include "candidates.hpp"
+
+namespace k_opt {
+
+/**
+ * @brief Implements k_opt::CutStrategy concept with a single cut, the
+ *        edge into a segment of up to max_seg_len vertices, which is
+ *        moved, as it is or reversed, onto an edge of one of the nearest
+ *        neighbours of its ends, O(L * m) per cut instead of a 3-opt
+ *        search over all triples. Weights are taken as symmetric as by
+ *        the other cuts.
+ *        Has to be run with k = 1 and dynamic K.
+ *        Neighbour lists are found on the first cut of an instance.
+ *        Applying a cut searches its best move again, so first better
+ *        and best cut heuristics apply the one they selected, equal
+ *        gains of other cuts do not matter.
+ */
+template<typename cost_t, IntrusiveVertex vertex_t>
+class CutOrOpt {
+    static_assert(std::is_arithmetic_v<cost_t>, "cost_t must be arithmetic");
+
+    using node_ptr = typename vertex_t::traits::node_ptr;
+    using seg_t = std::pair<node_ptr, node_ptr>;
+
+ public:
+
+    static constexpr int NUM_CUTS = -1;
+    static constexpr int MAX_SEG_LEN = 3;
+
+    explicit CutOrOpt(
+        const int max_seg_len = MAX_SEG_LEN,
+        const int num_neighbours = 8
+    ) : max_seg_len(max_seg_len), num_neighbours(num_neighbours)
+    {
+        if (max_seg_len < 1 || max_seg_len > MAX_SEG_LEN) {
+            throw std::invalid_argument(
+                "Segment length must be in [1, "
+              + std::to_string(MAX_SEG_LEN) + "]."
+            );
+        }
+        if (num_neighbours < 1) {
+            throw std::invalid_argument("Number of neighbours must be > 0.");
+        }
+    }
+
+    ~CutOrOpt() = default;
+
+    template<bool can_modify_segs>
+    [[ gnu::hot ]]
+    inline int selectCut(
+        const int n,
+        const seg_t * __restrict const segs,
+        cost_t &change,
+        const cost_t * __restrict const weights,
+        int &perm_idx,
+        [[ maybe_unused ]] const seg_t * __restrict const
+    ) const noexcept;
+
+    /// @brief Applies the best move of segs[0] on the last selected
+    ///        instance, if it improves.
+    inline void applyCut(
+        const seg_t * __restrict const segs,
+        [[ maybe_unused ]] const int move_ord = 0,
+        [[ maybe_unused ]] const int swap_mask = -1,
+        [[ maybe_unused ]] const seg_t * __restrict const orig_segs = nullptr
+    ) const noexcept;
+
+    [[ nodiscard ]] int getMaxSegLen() const noexcept {
+        return this->max_seg_len;
+    }
+
+ private:
+
+    struct Move {
+        node_ptr last;  // of the moved segment, first is after the cut
+        node_ptr after;
+        node_ptr dst;  // gets linked to an end of the segment
+        node_ptr dst_next;  // its neighbour, linked to the other end
+        bool is_reversed;  // dst linked to last
+    };
+
+    int max_seg_len;
+    int num_neighbours;
+
+    // neighbour lists of the weights they were found for
+    mutable const cost_t * neighbours_of = nullptr;
+    mutable int n = 0;
+    mutable int m = 0;
+    mutable std::vector<int> neighbours;  // [v * m + i]
+    mutable std::vector<node_ptr> nodes;  // by id, of the tour cut first
+
+    void findNeighbours(
+        const int n,
+        const seg_t &cut,
+        const cost_t * __restrict const weights
+    ) const;
+
+    /// @return Change of the best move of the cut, 0 if none improves.
+    [[ gnu::hot ]]
+    cost_t findBestMove(
+        const seg_t &cut,
+        const cost_t * __restrict const weights,
+        Move &best
+    ) const noexcept;
+};
+
+
+template<typename cost_t, IntrusiveVertex vertex_t>
+void CutOrOpt<cost_t, vertex_t>::findNeighbours(
+    const int n,
+    const seg_t &cut,
+    const cost_t * __restrict const weights
+) const {
+    this->n = n;
+    this->m = this->num_neighbours;
+    this->neighbours = detail::findCandidates(weights, n, this->m);
+    this->nodes.resize(n);
+    node_ptr prev = cut.second;
+    node_ptr cur = cut.first;
+    for (int i = 0; i < n; ++i) {
+        this->nodes[vertex_t::v(cur)->id] = cur;
+        node_ptr next = path_algos::get_neighbour<vertex_t>(cur, prev);
+        prev = cur;
+        cur = next;
+    }
+    this->neighbours_of = weights;
+}
+
+template<typename cost_t, IntrusiveVertex vertex_t>
+template<bool can_modify_segs>
+int CutOrOpt<cost_t, vertex_t>::selectCut(
+    const int n,
+    const seg_t * __restrict const segs,
+    cost_t &change,
+    const cost_t * __restrict const weights,
+    int &perm_idx,
+    [[ maybe_unused ]] const seg_t * __restrict const
+) const noexcept {
+    change = (cost_t) 0;
+    // the rest of the tour needs an edge apart from the reconnected one
+    if (n < 5) return 0;
+    if ( this->neighbours_of != weights
+      || this->nodes[vertex_t::v(segs[0].first)->id] != segs[0].first
+    ) [[ unlikely ]] {
+        this->findNeighbours(n, segs[0], weights);
+    }
+    Move best;
+    change = this->findBestMove(segs[0], weights, best);
+    if (change < (cost_t) 0) perm_idx = 0;
+    return 0;
+}
+
+template<typename cost_t, IntrusiveVertex vertex_t>
+cost_t CutOrOpt<cost_t, vertex_t>::findBestMove(
+    const seg_t &cut,
+    const cost_t * __restrict const weights,
+    Move &best
+) const noexcept {
+    const int n = this->n;
+    const int max_len = std::min(this->max_seg_len, n - 4);
+    const node_ptr before = cut.second;
+    const node_ptr first = cut.first;
+    const auto before_id = vertex_t::v(before)->id;
+    const auto first_id = vertex_t::v(first)->id;
+    node_ptr seg[MAX_SEG_LEN];
+    node_ptr prev = before;
+    node_ptr last = first;
+    cost_t best_change = (cost_t) 0;
+    for (int len = 1; len <= max_len; ++len) {
+        if (len > 1) {
+            const node_ptr next = path_algos::get_neighbour<vertex_t>(
+                last, prev
+            );
+            prev = last;
+            last = next;
+        }
+        seg[len - 1] = last;
+        const node_ptr after = path_algos::get_neighbour<vertex_t>(
+            last, prev
+        );
+        const auto last_id = vertex_t::v(last)->id;
+        const auto after_id = vertex_t::v(after)->id;
+        const cost_t removal_gain = weights[before_id * n + first_id]
+                                  + weights[last_id * n + after_id]
+                                  - weights[before_id * n + after_id];
+        const auto is_in_seg = [&] (const node_ptr v) {
+            for (int i = 0; i < len; ++i) {
+                if (seg[i] == v) return true;
+            }
+            return false;
+        };
+        // end linked to a neighbour dst, the other end to dst's neighbour
+        for (int end_idx = 0; end_idx < 2; ++end_idx) {
+            const auto end_id = end_idx == 0 ? first_id : last_id;
+            const auto other_id = end_idx == 0 ? last_id : first_id;
+            const int * const cands = this->neighbours.data()
+                                    + end_id * this->m;
+            for (int i = 0; i < this->m; ++i) {
+                const node_ptr dst = this->nodes[cands[i]];
+                if (is_in_seg(dst)) continue;
+                const auto dst_id = vertex_t::v(dst)->id;
+                const node_ptr dst_nexts[2] = {
+                    vertex_t::traits::get_next(dst),
+                    vertex_t::traits::get_previous(dst)
+                };
+                for (const node_ptr dst_next : dst_nexts) {
+                    if (is_in_seg(dst_next)) continue;
+                    const auto dst_next_id = vertex_t::v(dst_next)->id;
+                    const cost_t cur_change = weights[dst_id * n + end_id]
+                        + weights[other_id * n + dst_next_id]
+                        - weights[dst_id * n + dst_next_id]
+                        - removal_gain;
+                    if (cur_change < best_change) {
+                        best_change = cur_change;
+                        best = { last, after, dst, dst_next, end_idx == 1 };
+                    }
+                }
+            }
+        }
+    }
+    return best_change;
+}
+
+template<typename cost_t, IntrusiveVertex v_t>
+void CutOrOpt<cost_t, v_t>::applyCut(
+    const seg_t * __restrict const segs,
+    [[ maybe_unused ]] const int,
+    [[ maybe_unused ]] const int,
+    [[ maybe_unused ]] const seg_t * __restrict const
+) const noexcept {
+    if (this->neighbours_of == nullptr) return;
+    Move move;
+    const cost_t change = this->findBestMove(
+        segs[0], this->neighbours_of, move
+    );
+    if (change >= (cost_t) 0) return;
+    const node_ptr before = segs[0].second;
+    const node_ptr first = segs[0].first;
+    const node_ptr last = move.last;
+    const node_ptr after = move.after;
+    const node_ptr dst = move.dst;
+    const node_ptr dst_next = move.dst_next;
+    // ends linked to dst and dst_next
+    const node_ptr to_dst = move.is_reversed ? last : first;
+    const node_ptr to_dst_next = move.is_reversed ? first : last;
+
+    // each replaced neighbour is an old one, so slots are found uniquely
+    if (first == last) {  // both of its neighbours are replaced
+        v_t::traits::set_previous(first, dst);
+        v_t::traits::set_next(first, dst_next);
+    } else {
+        path_algos::set_neighbour<v_t>(to_dst,
+            to_dst == first ? before : after, dst);
+        path_algos::set_neighbour<v_t>(to_dst_next,
+            to_dst_next == first ? before : after, dst_next);
+    }
+    path_algos::set_neighbour<v_t>(before, first, after);
+    path_algos::set_neighbour<v_t>(after, last, before);
+    path_algos::set_neighbour<v_t>(dst, dst_next, to_dst);
+    path_algos::set_neighbour<v_t>(dst_next, dst, to_dst_next);
+}
+
+}  // namespace k_opt
+
+#endif
@@ -10,11 +10,14 @@
 #include "cut_2_opt.hpp"
 #include "cut_3_opt.hpp"
 #include "cut_k_opt.hpp"
+#include "cut_hk_window.hpp"
+#include "cut_or_opt.hpp"
 #include "heuristic.hpp"
 #include "heuristic_best_cut.hpp"
 #include "heuristic_classical.hpp"
 #include "heuristic_funky.hpp"
 #include "heuristic_rand.hpp"
+#include "heuristic_lk.hpp"
 
 namespace k_opt {
 namespace factories {
@@ -26,7 +29,9 @@ std::variant<
     Cut3OptNo2Opt<cost_t, vertex_t>,
     CutKOpt<cost_t, vertex_t, 4>,
     CutKOpt<cost_t, vertex_t, 5>,
-    CutKOpt<cost_t, vertex_t, -1>
+    CutKOpt<cost_t, vertex_t, -1>,
+    CutHKWindow<cost_t, vertex_t>,
+    CutOrOpt<cost_t, vertex_t>
 > createCut(const std::string &cut_name, int &k) {
     using cut_t = std::variant<
         Cut2Opt<cost_t, vertex_t>,
@@ -34,7 +39,9 @@ std::variant<
         Cut3OptNo2Opt<cost_t, vertex_t>,
         CutKOpt<cost_t, vertex_t, 4>,
         CutKOpt<cost_t, vertex_t, 5>,
-        CutKOpt<cost_t, vertex_t, -1>
+        CutKOpt<cost_t, vertex_t, -1>,
+        CutHKWindow<cost_t, vertex_t>,
+        CutOrOpt<cost_t, vertex_t>
     >;
     using factory_t = std::function<cut_t ()>;
 
@@ -76,6 +83,22 @@ std::variant<
     };
     if (cuts.count(cut_name)) return cuts.at(cut_name)();
 
+    // hk_window or hk_window_<window size>, a single cut per window
+    const std::string hk_window_name = "hk_window";
+    if (cut_name.rfind(hk_window_name, 0) == 0) {
+        k = 1;
+        return CutHKWindow<cost_t, vertex_t>(
+            cut_name.size() == hk_window_name.size() ? 12
+                : std::stoi(cut_name.substr(hk_window_name.size() + 1))
+        );
+    }
+
+    // segments of up to 3 vertices moved next to their 8 nearest ones
+    if (cut_name == "or_opt") {
+        k = 1;
+        return CutOrOpt<cost_t, vertex_t>();
+    }
+
     using k_factory_t = std::function<cut_t (const int)>;
     const int sep_idx = cut_name.find('_');
     k = std::stoi(cut_name.substr(0, sep_idx));
@@ -126,6 +149,9 @@ createHeuristic(
                 cost_t, cut_t, vertex_t, K
             >>(cut, k);
         }},
+        { "lk", [&] () {  // searches its own exchanges, cut is unused
+            return std::make_unique<KOptLK<cost_t, vertex_t>>();
+        }},
         { "rand", [&] () {
             auto psrng = random::initPSRNG(seed);
             return std::make_unique<KOptRand<
@@ -136,14 +162,21 @@ createHeuristic(
     return heurs.at(heur_name)();
 }
 
+/// @param num_candidates - if > 0 cuts are searched only between this
+///                         many nearest neighbours, see
+///                         Heuristic::setNumCandidates
+/// @param dont_look_bits - search only around vertices touched by moves,
+///                         see Heuristic::setDontLookBits
 template<typename cost_t, k_opt::IntrusiveVertex vertex_t>
 std::unique_ptr<k_opt::Heuristic<cost_t, vertex_t>> createAlgo(
     const std::string &selection_algo_name,
     const std::string &cut_algo_name,
-    const unsigned int seed
+    const unsigned int seed,
+    const int num_candidates = 0,
+    const bool dont_look_bits = false
 ) {
     int k = -1;
-    return std::visit([&] (auto &&cut) {
+    auto algo = std::visit([&] (auto &&cut) {
         using cut_t = std::decay_t<decltype(cut)>;
         return createHeuristic<
             cost_t, cut_t, vertex_t, cut_t::NUM_CUTS
@@ -151,6 +184,9 @@ std::unique_ptr<k_opt::Heuristic<cost_t, vertex_t>> createAlgo(
             selection_algo_name, cut, seed, k
         );
     }, createCut<cost_t, vertex_t>(cut_algo_name, k));
+    algo->setNumCandidates(num_candidates);
+    algo->setDontLookBits(dont_look_bits);
+    return algo;
 }
 
 }  // namespace factories
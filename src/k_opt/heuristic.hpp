@@ -43,6 +43,29 @@ class Heuristic {
         [[ maybe_unused ]] const unsigned long long t_check_freq = 10000ULL
     );
 
+    /// @brief If m > 0 heuristics scanning cuts in tour order search only
+    ///        those chained by the m nearest vertices of each one, see
+    ///        detail::CandidateSegments, else every k-tuple of cuts.
+    void setNumCandidates(const int m) noexcept {
+        this->num_candidates = m;
+    }
+
+    [[ nodiscard ]] int getNumCandidates() const noexcept {
+        return this->num_candidates;
+    }
+
+    /// @brief If set heuristics scanning cuts in tour order search only
+    ///        cuts on edges of vertices in a queue of active ones, which
+    ///        holds every vertex at first and the endpoints of the edges
+    ///        each applied move changed, see detail::ActiveVertices.
+    void setDontLookBits(const bool is_on) noexcept {
+        this->use_dont_look_bits = is_on;
+    }
+
+    [[ nodiscard ]] bool getDontLookBits() const noexcept {
+        return this->use_dont_look_bits;
+    }
+
     virtual cost_t run(
         typename vertex_t::traits::node_ptr path,
         cost_t cur_cost,
@@ -65,6 +88,9 @@ class Heuristic {
 
  protected:
 
+    int num_candidates = 0;
+    bool use_dont_look_bits = false;
+
     virtual typename vertex_t::traits::node_ptr
     createInitSolution(
         std::vector<vertex_t> &solution,
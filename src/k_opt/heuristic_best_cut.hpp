@@ -9,6 +9,7 @@
 #include "heuristic.hpp"
 #include "vertex_concept.hpp"
 #include "cut_strategy.hpp"
+#include "candidates.hpp"
 
 namespace k_opt {
 
@@ -149,6 +150,9 @@ cost_t KOptBestCut<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
     }
 
     const cut_strategy_t * __restrict const cut = &this->cut;
+    detail::CandidateSegments<vertex_t> candidates(
+        weights, n, k, this->num_candidates
+    );
     int iter = 1;
     cost_t cur_cost_change = (cost_t) 0;
     cost_t best_cost = cur_cost;
@@ -191,7 +195,9 @@ cost_t KOptBestCut<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
             return false;
         };
 
-        if constexpr (K == -1) {
+        if (candidates.isUsed()) {
+            candidates.loop(path, k, n, segs, process_cut);
+        } else if constexpr (K == -1) {
             detail::loopSegmentsDynamic<vertex_t>(
                 vertex_t::traits::get_previous(path),
                 path,
@@ -208,6 +214,7 @@ cost_t KOptBestCut<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
         if (did_update) {
             cut->applyCut(best_segs, best_perm_idx,
                           best_swap, best_orig_segs);
+            candidates.markChanged();
             cur_cost = best_cost;
             history.addCost(cur_cost);
             // history.addPath(path, i, j, k, iter);
@@ -223,17 +230,12 @@ cost_t KOptBestCut<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
             }
         }
     }
+    // buffers get swapped, so either all of them are on heap or none
     if constexpr (K == -1) {
-        if (segs != seg_indices_arr.data()) {
+        if (k > 16) {
             delete[] segs;
-        }
-        if (segs_buf != seg_indices_buf_arr.data()) {
             delete[] segs_buf;
-        }
-        if (best_segs != best_segs_arr.data()) {
             delete[] best_segs;
-        }
-        if (best_orig_segs_mem != nullptr) {
             delete[] best_orig_segs_mem;
         }
     }
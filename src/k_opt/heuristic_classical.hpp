@@ -8,6 +8,8 @@
 #include <utility>
 #include "heuristic.hpp"
 #include "cut_strategy.hpp"
+#include "candidates.hpp"
+#include "active_vertices.hpp"
 
 namespace k_opt {
 
@@ -135,6 +137,12 @@ cost_t KOptClassical<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
     }
 
     const cut_strategy_t * __restrict const cut = &this->cut;
+    detail::CandidateSegments<vertex_t> candidates(
+        weights, n, k, this->num_candidates
+    );
+    detail::ActiveVertices<vertex_t> active(
+        path, n, k, this->use_dont_look_bits
+    );
     int iter = 1;
     cost_t cur_cost_change = (cost_t) 0;
     for (bool did_update = true; did_update; ++iter) {
@@ -174,7 +182,11 @@ cost_t KOptClassical<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
             return false;
         };
 
-        if constexpr (K == -1) {
+        if (active.isUsed()) {
+            active.template loop<K>(candidates, k, n, segs, process_cut);
+        } else if (candidates.isUsed()) {
+            candidates.loop(path, k, n, segs, process_cut);
+        } else if constexpr (K == -1) {
             detail::loopSegmentsDynamic<vertex_t>(
                 vertex_t::traits::get_previous(path),
                 path,
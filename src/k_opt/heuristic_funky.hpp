@@ -9,6 +9,8 @@
 #include <x86intrin.h>  // __rdtsc()
 #include "heuristic.hpp"
 #include "cut_strategy.hpp"
+#include "candidates.hpp"
+#include "active_vertices.hpp"
 
 namespace k_opt {
 
@@ -140,6 +142,12 @@ cost_t KOptFunky<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
     segs[0].first = path;
 
     const cut_strategy_t * __restrict const cut = &this->cut;
+    detail::CandidateSegments<vertex_t> candidates(
+        weights, n, k, this->num_candidates
+    );
+    detail::ActiveVertices<vertex_t> active(
+        path, n, k, this->use_dont_look_bits
+    );
     int iter = 1;
     for (bool did_update = true; did_update; ++iter) {
         if (verbose > 0 && (iter < 10 || iter % log_freq == 0)) {
@@ -180,7 +188,11 @@ cost_t KOptFunky<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
 
         auto start = segs[0].first;  // start from furthest vertex
         auto prev = vertex_t::traits::get_previous(start);
-        if constexpr (K == -1) {
+        if (active.isUsed()) {
+            active.template loop<K>(candidates, k, n, segs, process_cut);
+        } else if (candidates.isUsed()) {
+            candidates.loop(start, k, n, segs, process_cut);
+        } else if constexpr (K == -1) {
             detail::loopSegmentsDynamic<vertex_t>(
                 prev, start,
                 0, 0, k, n, segs, process_cut
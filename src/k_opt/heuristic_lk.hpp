@@ -0,0 +1,460 @@
+#ifndef TSP_K_OPT_HEURISTIC_LK_HPP
+#define TSP_K_OPT_HEURISTIC_LK_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <x86intrin.h>  // __rdtsc()
+#include "heuristic.hpp"
+#include "candidates.hpp"
+
+namespace k_opt {
+namespace detail {
+
+/**
+ * @brief Lin-Kernighan step search over an array tour of vertex ids.
+ *        A chain keeps t1 and the edge (t1, t2) to break, at each level
+ *        adds (t2, t3) for a candidate t3 of t2 while the gain stays
+ *        positive, breaks (t4, t3) for t4 before t3 and closes by flipping
+ *        t2..t4, so every level is a 2-opt move leaving a tour and t4
+ *        becomes the next t2. The best closed tour of the chain is kept.
+ *        Alternatives of the first levels are tried in turn, deeper ones
+ *        follow the best by d(t3, t4) - d(t2, t3) only.
+ *        Weights are taken as symmetric as by the cuts.
+ */
+template<typename cost_t>
+class LKSearch {
+ public:
+
+    static constexpr int MAX_BREADTH = 8;
+
+    LKSearch(
+        const cost_t * __restrict const weights,
+        const int n,
+        const int m,
+        const int max_depth,
+        const std::vector<int> &breadths
+    ) : weights(weights), n(n), m(m), max_depth(max_depth),
+        breadths(breadths), order(n), pos(n)
+    {
+        this->candidates = findCandidates(weights, n, this->m);
+    }
+
+    /// @param ids Tour as vertex ids, any orientation.
+    void fill(const std::vector<int> &ids) noexcept {
+        for (int i = 0; i < this->n; ++i) {
+            this->order[i] = ids[i];
+            this->pos[ids[i]] = i;
+        }
+    }
+
+    [[ nodiscard ]] const std::vector<int>& getOrder() const noexcept {
+        return this->order;
+    }
+
+    /// @return Vertices on the edges changed by the last improve.
+    [[ nodiscard ]] const std::vector<int>& getTouched() const noexcept {
+        return this->touched;
+    }
+
+    /// @return Decrease of the tour cost, > 0 if a chain from t1 improved
+    ///         and was applied, else 0 with the tour unchanged.
+    [[ gnu::hot ]]
+    cost_t improve(const int t1) noexcept {
+        this->touched.clear();
+        for (const bool is_rev : { false, true }) {
+            this->t1 = t1;
+            this->is_rev = is_rev;
+            this->best_gain = (cost_t) 0;
+            this->best_len = 0;
+            const int t2 = this->succ(t1);
+            this->removed.assign(1, edge(t1, t2));
+            this->added.clear();
+            if (this->step(0, t2, this->w(t1, t2))) {
+                return this->best_gain;
+            }
+        }
+        return (cost_t) 0;
+    }
+
+ private:
+
+    struct Flip {
+        int start;  // position of the reversed range
+        int len;
+        bool was_rev;
+        int t2, t3, t4;
+    };
+
+    const cost_t * __restrict weights;
+    int n;
+    int m;
+    int max_depth;
+    std::vector<int> breadths;  // of the first levels, 1 for the rest
+    std::vector<int> candidates;  // [v * m + i]
+    std::vector<int> order;
+    std::vector<int> pos;  // by id
+
+    // chain state
+    int t1 = 0;
+    bool is_rev = false;  // succ is previous in order
+    cost_t best_gain = (cost_t) 0;
+    int best_len = 0;
+    std::vector<Flip> flips;
+    std::vector<std::pair<int, int>> removed;
+    std::vector<std::pair<int, int>> added;
+    std::vector<int> touched;
+
+    [[ gnu::always_inline ]]
+    cost_t w(const int a, const int b) const noexcept {
+        return this->weights[a * this->n + b];
+    }
+
+    [[ gnu::always_inline ]]
+    int next(const int v) const noexcept {
+        const int p = this->pos[v] + 1;
+        return this->order[p == this->n ? 0 : p];
+    }
+
+    [[ gnu::always_inline ]]
+    int prev(const int v) const noexcept {
+        const int p = this->pos[v];
+        return this->order[p == 0 ? this->n - 1 : p - 1];
+    }
+
+    int succ(const int v) const noexcept {
+        return this->is_rev ? this->prev(v) : this->next(v);
+    }
+
+    int pred(const int v) const noexcept {
+        return this->is_rev ? this->next(v) : this->prev(v);
+    }
+
+    static std::pair<int, int> edge(const int a, const int b) noexcept {
+        return a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+    }
+
+    static bool contains(
+        const std::vector<std::pair<int, int>> &edges,
+        const std::pair<int, int> &e
+    ) noexcept {
+        return std::find(edges.begin(), edges.end(), e) != edges.end();
+    }
+
+    /// @brief Reverses len positions of order from start on, cyclically.
+    void reverse(const int start, const int len) noexcept {
+        const int n = this->n;
+        for (int i = start, j = start + len - 1; i < j; ++i, --j) {
+            const int pi = i < n ? i : i - n, pj = j < n ? j : j - n;
+            std::swap(this->order[pi], this->order[pj]);
+            this->pos[this->order[pi]] = pi;
+            this->pos[this->order[pj]] = pj;
+        }
+    }
+
+    /// @brief Flips t2..t4 of succ(t1) == t2, pred(t3) == t4, so that
+    ///        succ(t1) == t4 and succ(t2) == t3, reversing the shorter of
+    ///        the path and the rest of the tour, the latter mirrors the
+    ///        order, so orientation is then taken from t1.
+    void flip(const int t2, const int t3, const int t4) noexcept {
+        const int a = this->is_rev ? t4 : t2;
+        const int b = this->is_rev ? t2 : t4;
+        int start = this->pos[a];
+        int len = this->pos[b] - start;
+        len = (len < 0 ? len + this->n : len) + 1;
+        if (2 * len > this->n) {
+            start = this->pos[b] + 1;
+            len = this->n - len;
+        }
+        this->reverse(start, len);
+        this->flips.push_back({ start, len, this->is_rev, t2, t3, t4 });
+        this->is_rev = this->next(this->t1) != t4;
+    }
+
+    void undoFlip() noexcept {
+        const Flip &f = this->flips.back();
+        this->reverse(f.start, f.len);
+        this->is_rev = f.was_rev;
+        this->flips.pop_back();
+    }
+
+    /// @brief Keeps the best closed tour of the chain if it improves.
+    bool commit() noexcept {
+        if (this->best_gain <= 1e-10) return false;
+        while (static_cast<int>(this->flips.size()) > this->best_len) {
+            this->undoFlip();
+        }
+        this->touched.push_back(this->t1);
+        for (const Flip &f : this->flips) {
+            this->touched.push_back(f.t2);
+            this->touched.push_back(f.t3);
+            this->touched.push_back(f.t4);
+        }
+        this->flips.clear();
+        return true;
+    }
+
+    /// @param gain Of removed minus added edges, (t1, t2) counted as
+    ///             removed, so the closed tour is gain - d(t2, t1) cheaper.
+    /// @return Whether an improving chain was applied.
+    [[ gnu::hot ]]
+    bool step(const int level, const int t2, const cost_t gain) noexcept {
+        const int breadth = level < static_cast<int>(this->breadths.size())
+                          ? this->breadths[level] : 1;
+        int alts[MAX_BREADTH];
+        cost_t alt_gains[MAX_BREADTH];
+        int num_alts = 0;
+        if (level < this->max_depth) {
+            const int t2_succ = this->succ(t2);
+            const int * const cands = this->candidates.data() + t2 * this->m;
+            for (int i = 0; i < this->m; ++i) {
+                const int t3 = cands[i];
+                const cost_t g1 = gain - this->w(t2, t3);
+                if (g1 <= 1e-10) break;  // candidates are sorted
+                if (t3 == this->t1 || t3 == t2_succ) continue;
+                const int t4 = this->pred(t3);
+                if (contains(this->removed, edge(t2, t3))
+                 || contains(this->added, edge(t3, t4))) continue;
+                // insert by the gain after breaking (t4, t3)
+                const cost_t g2 = g1 + this->w(t4, t3);
+                if (num_alts == breadth && alt_gains[breadth - 1] >= g2) {
+                    continue;
+                }
+                int j = num_alts < breadth ? num_alts++ : breadth - 1;
+                for (; j > 0 && alt_gains[j - 1] < g2; --j) {
+                    alts[j] = alts[j - 1];
+                    alt_gains[j] = alt_gains[j - 1];
+                }
+                alts[j] = t3;
+                alt_gains[j] = g2;
+            }
+        }
+        if (num_alts == 0) return this->commit();
+
+        for (int i = 0; i < num_alts; ++i) {
+            const int t3 = alts[i];
+            const int t4 = this->pred(t3);
+            this->flip(t2, t3, t4);
+            this->added.push_back(edge(t2, t3));
+            this->removed.push_back(edge(t4, t3));
+            const cost_t closed_gain = alt_gains[i] - this->w(t4, this->t1);
+            if (closed_gain > this->best_gain) {
+                this->best_gain = closed_gain;
+                this->best_len = this->flips.size();
+            }
+            if (this->step(level + 1, t4, alt_gains[i])) return true;
+            this->added.pop_back();
+            this->removed.pop_back();
+            this->undoFlip();
+        }
+        return false;
+    }
+};
+
+}  // namespace detail
+
+/**
+ * @brief Lin-Kernighan style variable depth search, see
+ *        detail::LKSearch. Chains start from vertices in a FIFO queue,
+ *        holding every vertex at first and then those on the edges each
+ *        applied chain changed, until no chain improves.
+ *        Candidates are the num_candidates nearest vertices, or 8 if that
+ *        is not set; the cut given to factories is not used.
+ */
+template<typename cost_t, IntrusiveVertex vertex_t>
+class KOptLK : public Heuristic<cost_t, vertex_t>
+{
+ public:
+
+    static constexpr int DEFAULT_NUM_CANDIDATES = 8;
+
+    /// @param max_depth - maximum number of exchanges in a chain
+    /// @param breadths - alternatives tried at each of the first levels,
+    ///                   deeper levels take only the best one
+    explicit KOptLK(
+        const int max_depth = 50,
+        std::vector<int> breadths = { 5, 3 }
+    ) : max_depth(max_depth), breadths(std::move(breadths))
+    {
+        if (max_depth < 1) {
+            throw std::invalid_argument("Max depth must be > 0.");
+        }
+        for (const int b : this->breadths) {
+            if (b < 1 || b > detail::LKSearch<cost_t>::MAX_BREADTH) {
+                throw std::invalid_argument(
+                    "Breadth must be in [1, "
+                  + std::to_string(detail::LKSearch<cost_t>::MAX_BREADTH)
+                  + "]."
+                );
+            }
+        }
+    }
+
+    ~KOptLK() = default;
+
+    cost_t run(
+        typename vertex_t::traits::node_ptr path,
+        cost_t cur_cost,
+        History<cost_t> &history,
+        const cost_t * __restrict const flat_weights,
+        const int n,
+        const int verbose = 0
+    ) const noexcept override {
+        return this->template run_internal<false>(
+            path, cur_cost, history,
+            flat_weights, n, verbose
+        );
+    }
+
+    cost_t run_tlimit(
+        typename vertex_t::traits::node_ptr path,
+        cost_t cur_cost,
+        History<cost_t> &history,
+        const cost_t * __restrict const flat_weights,
+        const int n,
+        const int verbose = 0,
+        [[ maybe_unused ]] const unsigned long long max_exec = 0ULL,
+        [[ maybe_unused ]] const unsigned long long t_check_freq = 10000ULL
+    ) const noexcept override {
+        return this->template run_internal<true>(
+            path, cur_cost, history,
+            flat_weights, n, verbose,
+            max_exec, t_check_freq
+        );
+    }
+
+ protected:
+
+    template<bool with_time_limit>
+    cost_t run_internal(
+        typename vertex_t::traits::node_ptr path,
+        cost_t cur_cost,
+        History<cost_t> &history,
+        const cost_t * __restrict const weights,
+        const int n,
+        const int verbose,
+        [[ maybe_unused ]] const unsigned long long max_exec = 0ULL,
+        [[ maybe_unused ]] const unsigned long long t_check_freq = 10000ULL
+    ) const noexcept;
+
+ private:
+
+    int max_depth;
+    std::vector<int> breadths;
+
+};
+
+
+template<typename cost_t, IntrusiveVertex vertex_t>
+template<bool with_time_limit>
+cost_t KOptLK<cost_t, vertex_t>::run_internal(
+    typename vertex_t::traits::node_ptr path,
+    cost_t cur_cost,
+    History<cost_t> &history,
+    const cost_t * __restrict const weights,
+    const int n,
+    const int verbose,
+    [[ maybe_unused ]] unsigned long long max_exec,
+    [[ maybe_unused ]] const unsigned long long t_check_freq
+) const noexcept {
+    unsigned long long t_freq = t_check_freq;
+    if constexpr (with_time_limit) {
+        max_exec += __rdtsc();
+    }
+
+    using node_ptr = typename vertex_t::traits::node_ptr;
+    // a 2-opt move needs 2 edges apart from the broken ones
+    if (n < 5) return cur_cost;
+    const int log_freq = 10;  // log best cost every 10 improvements
+    const int flush_freq = 10000;  // flush every 10000 costs
+    const bool do_record_history = !history.isStopped();
+    history.addCost(cur_cost);
+
+    std::vector<node_ptr> nodes(n);  // by id
+    std::vector<int> ids(n);
+    {
+        auto prev = vertex_t::traits::get_previous(path);
+        auto cur = path;
+        for (int i = 0; i < n; ++i) {
+            ids[i] = vertex_t::v(cur)->id;
+            nodes[ids[i]] = cur;
+            auto next = k_opt::path_algos::get_neighbour<vertex_t>(cur, prev);
+            prev = cur;
+            cur = next;
+        }
+    }
+    detail::LKSearch<cost_t> lk(
+        weights, n,
+        this->num_candidates > 0 ? this->num_candidates
+                                 : DEFAULT_NUM_CANDIDATES,
+        this->max_depth, this->breadths
+    );
+    lk.fill(ids);
+
+    // don't-look bits, a ring of ids each queued at most once
+    std::vector<char> is_active(n, true);
+    std::vector<int> queue(ids);
+    int head = 0;
+    int num_queued = n;
+    const auto push = [&] (const int id) {
+        if (is_active[id]) return;
+        is_active[id] = true;
+        queue[(head + num_queued) % n] = id;
+        ++num_queued;
+    };
+
+    int iter = 1;
+    while (num_queued > 0) {
+        if constexpr (with_time_limit) {
+            if (--t_freq == 0) [[ unlikely ]] {
+                if (__rdtsc() >= max_exec) [[ unlikely ]] break;
+                t_freq = t_check_freq;
+            }
+        }
+        const int t1 = queue[head];
+        head = head + 1 == n ? 0 : head + 1;
+        --num_queued;
+        is_active[t1] = false;
+        const cost_t gain = lk.improve(t1);
+        if (gain <= (cost_t) 0) continue;
+        for (const int id : lk.getTouched()) push(id);
+        cur_cost -= gain;
+        history.addCost(cur_cost);
+        if (verbose > 0 && (iter < 10 || iter % log_freq == 0)) {
+            std::cout << "ITERATION " << iter << ": "
+                      << cur_cost << std::endl;
+        }
+        ++iter;
+        if (do_record_history && history.size() % flush_freq == 0)
+            [[ unlikely ]]
+        {
+            history.flush(true);
+        }
+    }
+    if (do_record_history) history.flush(true);
+
+    // relink the list in the found order
+    const std::vector<int> &order = lk.getOrder();
+    for (int i = 0; i < n; ++i) {
+        const node_ptr cur = nodes[order[i]];
+        const node_ptr next = nodes[order[i + 1 < n ? i + 1 : 0]];
+        vertex_t::traits::set_next(cur, next);
+        vertex_t::traits::set_previous(next, cur);
+    }
+
+    if (verbose > 0) {  // log cost after last iteration
+        std::cout << std::fixed << std::setprecision(6)
+                  << "Last ITERATION " << iter << ": "
+                  << cur_cost << std::defaultfloat
+                  << std::endl;
+    }
+    return cur_cost;
+}
+
+}  // namespace k_opt
+
+#endif
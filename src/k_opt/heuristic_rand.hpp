@@ -11,6 +11,7 @@
 #include "heuristic.hpp"
 #include "heuristic_funky.hpp"
 #include "cut_strategy.hpp"
+#include "array_tour.hpp"
 
 namespace k_opt {
 
@@ -96,6 +97,7 @@ class KOptRand : public Heuristic<cost_t, vertex_t>
     mutable boost::random::mt19937 psrng;
     int k;
 
+    /// @param cuts Set to indices in nodes_by_idx after which segs end.
     [[ gnu::hot ]]
     inline bool genRandomSegments(
         int max_idx,
@@ -104,7 +106,9 @@ class KOptRand : public Heuristic<cost_t, vertex_t>
             typename vertex_t::traits::node_ptr,
             typename vertex_t::traits::node_ptr
         > * __restrict const segs,
-        typename vertex_t::traits::node_ptr * __restrict const nodes_by_idx,
+        const typename vertex_t::traits::node_ptr * __restrict const
+            nodes_by_idx,
+        int * __restrict const cuts,
         std::vector<bool> &forbidden
     ) const noexcept;
 
@@ -120,7 +124,8 @@ bool KOptRand<cost_t, cut_strategy_t, vertex_t, K>::genRandomSegments(
         typename vertex_t::traits::node_ptr,
         typename vertex_t::traits::node_ptr
     > * __restrict const segs,
-    typename vertex_t::traits::node_ptr * __restrict const nodes_by_idx,
+    const typename vertex_t::traits::node_ptr * __restrict const nodes_by_idx,
+    int * __restrict const cuts,
     std::vector<bool> &forbidden
 ) const noexcept {
     using distr_t = boost::random::uniform_int_distribution<
@@ -141,6 +146,7 @@ bool KOptRand<cost_t, cut_strategy_t, vertex_t, K>::genRandomSegments(
                 return true;
             }
         }
+        cuts[idx] = rnd_idx - 1;
         auto next = nodes_by_idx[rnd_idx];
         auto next_id = vertex_t::v(next)->id;
         if (forbidden[next_id]) [[ unlikely ]] {
@@ -230,8 +236,14 @@ cost_t KOptRand<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
         segs[0].first = path;
     }
 
-    std::vector<seg_ptr> nodes_by_idx_(n);
-    seg_ptr * __restrict const nodes_by_idx = nodes_by_idx_.data();
+    // kept in step with applied moves instead of walked each iteration
+    ArrayTour<vertex_t> tour(n);
+    tour.fill(path);
+    std::vector<int> cuts(k);
+    const auto relink = [&] (const int offset) {
+        for (int &cut : cuts) cut += offset;
+        tour.relink(cuts.data(), k);
+    };
 
     std::vector<bool> forbidden(n, false);
     const int forbidden_clear_freq = n / k / 10;  // 10% of distinct k tuples
@@ -283,25 +295,18 @@ cost_t KOptRand<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
             return false;
         };
 
+        const int offset = tour.posOf(segs[0].first);
+        const seg_ptr * __restrict const nodes_by_idx = tour.from(offset);
         if (no_collision) [[ likely ]] {
-            seg_ptr cur = segs[0].first;
-            seg_ptr prev = vertex_t::traits::get_previous(cur);
-            for (int i = 0; i < n / 2; ++i) {
-                nodes_by_idx[i] = cur;
-                auto next = path_algos::get_neighbour<vertex_t>(cur, prev);
-                prev = cur;
-                cur = next;
-            }
             for (int i = n / 2; i < n; ++i) {
-                nodes_by_idx[i] = cur;
-                auto next = path_algos::get_neighbour<vertex_t>(cur, prev);
-                prev = cur;
-                cur = next;
                 const bool did_gen = this->genRandomSegments(
-                    i + 1, k, segs, nodes_by_idx, forbidden
+                    i + 1, k, segs, nodes_by_idx, cuts.data(), forbidden
                 );
                 if (did_gen) [[ likely ]] {
-                    if (process_cut()) [[ unlikely ]] break;
+                    if (process_cut()) [[ unlikely ]] {
+                        relink(offset);
+                        break;
+                    }
                 }
             }
         }
@@ -312,16 +317,19 @@ cost_t KOptRand<cost_t, cut_strategy_t, vertex_t, K>::run_internal(
                     --tries_left
                 ) {
                     const bool did_gen = this->genRandomSegments(
-                        n, k, segs, nodes_by_idx, forbidden
+                        n, k, segs, nodes_by_idx, cuts.data(), forbidden
                     );
                     if (did_gen) [[ likely ]] {
-                        if (process_cut()) [[ unlikely ]] break;
+                        if (process_cut()) [[ unlikely ]] {
+                            relink(offset);
+                            break;
+                        }
                     }
                 }
             }
 
             if (!did_update) [[ unlikely ]] {  // funky fallback
-                no_collision = false;
+                no_collision = false;  // tour is not followed from here on
                 // start from furthest vertex
                 auto start = segs[0].first;
                 auto prev = vertex_t::traits::get_previous(start);
@@ -23,7 +23,9 @@ cost_t Solve(
     std::vector<std::vector<cost_t>> &distances,
     const bool is_searching_for_cycle,
     k_opt::History<cost_t> &history,
-    const unsigned int seed
+    const unsigned int seed,
+    const int num_candidates,
+    const bool dont_look_bits
 );
 
 namespace detail {
@@ -35,6 +37,19 @@ bool hasFlag(int argc, const char **argv, const std::string& flag) {
     return false;
 }
 
+/// @return value of the last `flag=value` argument, default_value if none
+int getFlagValue(int argc, const char **argv, const std::string& flag,
+                 const int default_value) {
+    int value = default_value;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind(flag + "=", 0) == 0) {
+            value = std::stoi(arg.substr(flag.size() + 1));
+        }
+    }
+    return value;
+}
+
 template<k_opt::IntrusiveVertex vertex_t>
 void logPath(
     typename vertex_t::traits::const_node_ptr path,
@@ -71,6 +86,12 @@ int main(const int argc, const char **argv)
                                         ? true  // not TSPLIB format by default
                                         : std::atoi(argv[10]);
     const bool is_history_off = detail::hasFlag(argc, argv, "--no-history");
+    // if > 0 only cuts between this many nearest neighbours are searched
+    const int num_candidates = detail::getFlagValue(argc, argv,
+                                                    "--candidates", 0);
+    // only cuts around vertices touched by the last moves are searched
+    const bool dont_look_bits = detail::hasFlag(argc, argv,
+                                                "--dont-look-bits");
 
     std::cout << "Solving "
               << (is_searching_for_cycle ? "TSP" : "SHP")
@@ -109,7 +130,9 @@ int main(const int argc, const char **argv)
                 const cost_t min_cost = Solve<cost_t>(
                     selection_name, cut_name,
                     distances, is_searching_for_cycle, *cur_history,
-                    seed++  // e.g. good: 3310318500
+                    seed++,  // e.g. good: 3310318500
+                    num_candidates,
+                    dont_look_bits
                 );
                 avg_min_cost_in_n_reruns += min_cost;
                 best_cost_in_n_reruns = std::min(best_cost_in_n_reruns, min_cost);
@@ -151,7 +174,9 @@ cost_t Solve(
     std::vector<std::vector<cost_t>> &distances,
     const bool is_searching_for_cycle,
     k_opt::History<cost_t> &history,
-    const unsigned int seed
+    const unsigned int seed,
+    const int num_candidates,
+    const bool dont_look_bits
 ) {
     using id_t = int;
     using vertex_t = k_opt::Vertex<id_t>;
@@ -159,7 +184,7 @@ cost_t Solve(
     const int n = distances.size();
     std::cout << "Seed: " << seed << std::endl;
     const auto algo = k_opt::factories::createAlgo<cost_t, vertex_t>(
-        selection_name, cut_name, seed);
+        selection_name, cut_name, seed, num_candidates, dont_look_bits);
 
     std::vector<vertex_t> path_buffer;
     typename vertex_t::traits::node_ptr path;